@@ -416,6 +416,7 @@ solution "LumixEngine"
 			"-msse2",
 			"-Wno-multichar",
 			"-Wno-undef",
+			"-Wno-ignored-attributes",
 		}
 		
 		if "linux-clang" ~= _OPTIONS["gcc"] then
@@ -1,7 +1,10 @@
 #include "animation/animation.h"
+#include "engine/atomic.h"
+#include "engine/crt.h"
 #include "engine/log.h"
 #include "engine/math.h"
 #include "engine/profiler.h"
+#include "engine/simd.h"
 #include "engine/stream.h"
 #include "engine/math.h"
 #include "renderer/model.h"
@@ -17,22 +20,253 @@ const ResourceType Animation::TYPE("animation");
 
 Animation::Animation(const Path& path, ResourceManager& resource_manager, IAllocator& allocator)
 	: Resource(path, resource_manager, allocator)
+	, m_allocator(allocator)
 	, m_mem(allocator)
 	, m_translations(allocator)
 	, m_rotations(allocator)
+	, m_bindings(allocator)
 {
 }
 
 
+static_assert(BoneMask::BITS_COUNT * 64 >= Model::Bone::MAX_COUNT);
+
+
+BoneMask::BoneMask(BoneMask&& rhs)
+	: name(rhs.name)
+	, bones(static_cast<HashMap<BoneNameHash, u8>&&>(rhs.bones))
+	, m_allocator(rhs.m_allocator)
+	, m_bits(static_cast<Array<UniquePtr<Bits>>&&>(rhs.m_bits))
+	, m_bits_head(rhs.m_bits_head)
+{
+	rhs.m_bits_head = nullptr;
+}
+
+
+void BoneMask::invalidate() {
+	MutexGuard lock(m_mutex);
+	m_bits_head = nullptr;
+	m_bits.clear();
+}
+
+
+void BoneMask::getBits(const Model& model, u64 (&bits)[BITS_COUNT]) const {
+	ASSERT(model.isReady());
+	const u32 skeleton_id = model.getSkeletonID();
+	for (const Bits* b = m_bits_head; b; b = b->next) {
+		if (b->skeleton_id != skeleton_id) continue;
+		memcpy(bits, b->bits, sizeof(bits));
+		return;
+	}
+
+	MutexGuard lock(m_mutex);
+	// could be added by another thread while we were not holding the lock
+	for (const Bits* b = m_bits_head; b; b = b->next) {
+		if (b->skeleton_id != skeleton_id) continue;
+		memcpy(bits, b->bits, sizeof(bits));
+		return;
+	}
+
+	UniquePtr<Bits> b = UniquePtr<Bits>::create(m_allocator);
+	b->skeleton_id = skeleton_id;
+	memset(b->bits, 0, sizeof(b->bits));
+	for (auto iter = bones.begin(), end = bones.end(); iter != end; ++iter) {
+		const Model::BoneMap::ConstIterator bone_iter = model.getBoneIndex(iter.key());
+		if (!bone_iter.isValid()) continue;
+		const u32 idx = bone_iter.value();
+		b->bits[idx >> 6] |= u64(1) << (idx & 63);
+	}
+	memcpy(bits, b->bits, sizeof(bits));
+	b->next = m_bits_head;
+	memoryBarrier();
+	m_bits_head = b.get();
+	m_bits.push(b.move());
+}
+
+
+const Animation::BoneBinding& Animation::getBinding(const Model& model) const {
+	ASSERT(model.isReady());
+	const u32 skeleton_id = model.getSkeletonID();
+	for (const BoneBinding* b = m_bindings_head; b; b = b->next) {
+		if (b->skeleton_id == skeleton_id) return *b;
+	}
+
+	MutexGuard lock(m_bindings_mutex);
+	// could be added by another thread while we were not holding the lock
+	for (const BoneBinding* b = m_bindings_head; b; b = b->next) {
+		if (b->skeleton_id == skeleton_id) return *b;
+	}
+
+	UniquePtr<BoneBinding> binding = UniquePtr<BoneBinding>::create(m_allocator, m_allocator);
+	binding->skeleton_id = skeleton_id;
+	binding->translations.resize(m_translations.size());
+	binding->rotations.resize(m_rotations.size());
+	for (i32 i = 0, c = m_translations.size(); i < c; ++i) {
+		const Model::BoneMap::ConstIterator iter = model.getBoneIndex(m_translations[i].name);
+		binding->translations[i] = iter.isValid() ? i16(iter.value()) : -1;
+	}
+	for (i32 i = 0, c = m_rotations.size(); i < c; ++i) {
+		const Model::BoneMap::ConstIterator iter = model.getBoneIndex(m_rotations[i].name);
+		binding->rotations[i] = iter.isValid() ? i16(iter.value()) : -1;
+	}
+	const BoneBinding& res = *binding;
+	binding->next = m_bindings_head;
+	memoryBarrier();
+	m_bindings_head = binding.get();
+	m_bindings.push(binding.move());
+	return res;
+}
+
+
+// returns the index of the first key after `t`, clamped to [1, count - 1]
+// `cursor` holds the result of the previous search on the same curve, so forward playback needs just a step or two
+static LUMIX_FORCE_INLINE u32 findKey(const u16* times, u32 count, u16 t, u32* cursor) {
+	const u32 last = count - 1;
+	u32 lo = 1;
+	if (cursor) {
+		u32 idx = *cursor;
+		if (idx >= 1 && idx <= last && times[idx - 1] <= t) {
+			for (u32 i = 0; i < 4; ++i) {
+				if (idx == last || times[idx] > t) {
+					*cursor = idx;
+					return idx;
+				}
+				++idx;
+			}
+			lo = idx;
+		}
+	}
+
+	u32 hi = last;
+	while (lo < hi) {
+		const u32 mid = (lo + hi) >> 1;
+		if (times[mid] > t) hi = mid;
+		else lo = mid + 1;
+	}
+	if (cursor) *cursor = lo;
+	return lo;
+}
+
+
 struct AnimationSampler {
+	template <bool use_mask>
+	static LUMIX_FORCE_INLINE bool isBound(i32 bone_idx, const u64* mask_bits) {
+		if (bone_idx < 0) return false;
+		if constexpr (use_mask) return (mask_bits[bone_idx >> 6] & (u64(1) << (bone_idx & 63))) != 0;
+		return true;
+	}
+
+	static LUMIX_FORCE_INLINE Vec3 toVec3(float4 v) {
+		return Vec3(f4GetX(v), f4GetY(v), f4GetZ(v));
+	}
+
+	// reads one u16 past the key, that's why Animation::m_mem is padded
+	static LUMIX_FORCE_INLINE float4 decodePosition(const Animation::TranslationCurve& curve, u32 key) {
+		const float4 q = f4LoadU16x4(curve.pos + key * 3);
+		return f4Add(f4LoadUnaligned(curve.offset), f4Mul(q, f4LoadUnaligned(curve.scale)));
+	}
+
+	static LUMIX_FORCE_INLINE Quat decodeRotation(const Animation::RotationCurve& curve, u32 key) {
+		alignas(16) static const float SCALE[4] = { 2 * SQRT1_2 / 0xffFF, 2 * SQRT1_2 / 0xffFF, 2 * SQRT1_2 / 0x3fFF, 0 };
+		alignas(16) static const float OFFSET[4] = { SQRT1_2, SQRT1_2, SQRT1_2, 0 };
+		// removes the omitted component's index from the last u16
+		alignas(16) static const float INDEX_BITS[4][4] = {
+			{ 0, 0, 0, 0 },
+			{ 0, 0, 0x4000, 0 },
+			{ 0, 0, 0x8000, 0 },
+			{ 0, 0, 0xC000, 0 }
+		};
+
+		const u16* k = curve.rot + key * 3;
+		const u32 omitted = k[2] >> 14;
+		const float4 q = f4Sub(f4LoadU16x4(k), f4Load(INDEX_BITS[omitted]));
+		alignas(16) float v[4];
+		f4Store(v, f4Sub(f4Mul(q, f4Load(SCALE)), f4Load(OFFSET)));
+		const float w = sqrtf(maximum(0.f, 1 - v[0] * v[0] - v[1] * v[1] - v[2] * v[2]));
+		switch (omitted) {
+			case 0: return Quat(w, v[0], v[1], v[2]);
+			case 1: return Quat(v[0], w, v[1], v[2]);
+			case 2: return Quat(v[0], v[1], w, v[2]);
+			default: return Quat(v[0], v[1], v[2], w);
+		}
+	}
+
+	// `anim_t` is normalized time, `frame_idx` and `frame_t` is the same time in frames, used by sampled curves
+	static LUMIX_FORCE_INLINE Vec3 samplePosition(const Animation::TranslationCurve& curve, u16 anim_t, u32 frame_idx, float frame_t, u32* cursor) {
+		if (curve.times) {
+			const u32 idx = findKey(curve.times, curve.count, anim_t, cursor);
+			const float t = float(anim_t - curve.times[idx - 1]) / (curve.times[idx] - curve.times[idx - 1]);
+			const float4 a = decodePosition(curve, idx - 1);
+			const float4 b = decodePosition(curve, idx);
+			return toVec3(f4Add(a, f4Mul(f4Sub(b, a), f4Splat(t))));
+		}
+		if (curve.count > 1) {
+			const float4 a = decodePosition(curve, frame_idx);
+			const float4 b = decodePosition(curve, frame_idx + 1);
+			return toVec3(f4Add(a, f4Mul(f4Sub(b, a), f4Splat(frame_t))));
+		}
+		return toVec3(decodePosition(curve, 0));
+	}
+
+	static LUMIX_FORCE_INLINE Quat sampleRotation(const Animation::RotationCurve& curve, u16 anim_t, u32 frame_idx, float frame_t, u32* cursor) {
+		if (curve.times) {
+			const u32 idx = findKey(curve.times, curve.count, anim_t, cursor);
+			const float t = float(anim_t - curve.times[idx - 1]) / (curve.times[idx] - curve.times[idx - 1]);
+			return nlerp(decodeRotation(curve, idx - 1), decodeRotation(curve, idx), t);
+		}
+		if (curve.count > 1) {
+			return nlerp(decodeRotation(curve, frame_idx), decodeRotation(curve, frame_idx + 1), frame_t);
+		}
+		return decodeRotation(curve, 0);
+	}
+
+	// weighted samples are collected and blended into the pose 4 bones at once
+	template <typename T>
+	struct WeightedSamples {
+		enum { CAPACITY = 64 };
+		u16 bones[CAPACITY];
+		T values[CAPACITY];
+		u32 count = 0;
+	};
+
+	static LUMIX_FORCE_INLINE void flush(Pose& pose, WeightedSamples<Vec3>& samples, float weight) {
+		pose.blendPositions(Span<const u16>(samples.bones, samples.count), samples.values, weight);
+		samples.count = 0;
+	}
+
+	static LUMIX_FORCE_INLINE void flush(Pose& pose, WeightedSamples<Quat>& samples, float weight) {
+		pose.blendRotations(Span<const u16>(samples.bones, samples.count), samples.values, weight);
+		samples.count = 0;
+	}
+
+	template <typename T>
+	static LUMIX_FORCE_INLINE void push(Pose& pose, WeightedSamples<T>& samples, i32 bone, const T& value, float weight) {
+		samples.bones[samples.count] = u16(bone);
+		samples.values[samples.count] = value;
+		++samples.count;
+		if (samples.count == WeightedSamples<T>::CAPACITY) flush(pose, samples, weight);
+	}
+
 	template <bool use_mask, bool use_weight>
-	static void getRelativePose(const Animation& anim, Time time, Pose& pose, const Model& model, float weight, const BoneMask* mask) {
+	static void getRelativePose(const Animation& anim, Time time, Pose& pose, const Model& model, float weight, const BoneMask* mask, Span<u32> key_cursors) {
 		ASSERT(!pose.is_absolute);
 		ASSERT(model.isReady());
 
 		Vec3* pos = pose.positions;
 		Quat* rot = pose.rotations;
 
+		const Animation::BoneBinding& binding = anim.getBinding(model);
+		const i16* translation_bones = binding.translations.begin();
+		const i16* rotation_bones = binding.rotations.begin();
+		u64 mask_bits[BoneMask::BITS_COUNT];
+		if constexpr (use_mask) mask->getBits(model, mask_bits);
+
+		ASSERT(key_cursors.length() == 0 || key_cursors.length() >= anim.getCurvesCount());
+		u32* translation_cursors = key_cursors.length() > 0 ? key_cursors.begin() : nullptr;
+		u32* rotation_cursors = key_cursors.length() > 0 ? key_cursors.begin() + anim.m_translations.size() : nullptr;
+		WeightedSamples<Vec3> weighted_positions;
+		WeightedSamples<Quat> weighted_rotations;
+
 		if (time < anim.getLength()) {
 			const u64 anim_t_highres = ((u64)time.raw() << 16) / (anim.m_length.raw());
 			ASSERT(anim_t_highres <= 0xffFF);
@@ -42,146 +276,108 @@ struct AnimationSampler {
 			const u32 frame_idx = u32(frame_48_16 >> 16);
 			const float frame_t = (frame_48_16 & 0xffFF) / float(0xffFF);
 		
-			for (const Animation::TranslationCurve& curve : anim.m_translations) {
-				Model::BoneMap::ConstIterator iter = model.getBoneIndex(curve.name);
-				if (!iter.isValid()) continue;
-				if constexpr(use_mask) {
-					if (mask->bones.find(curve.name) == mask->bones.end()) continue;
-				}
-
-				Vec3 anim_pos;
-				if (curve.times) {
-					u32 idx = 1;
-					for (u32 c = curve.count; idx < c; ++idx) {
-						if (curve.times[idx] > anim_t) break;
-					}
-					const float t = float(anim_t - curve.times[idx - 1]) / (curve.times[idx] - curve.times[idx - 1]);
-					anim_pos = lerp(curve.pos[idx - 1], curve.pos[idx], t);
-				}
-				else {
-					anim_pos = lerp(curve.pos[frame_idx], curve.pos[frame_idx + 1], frame_t);
-				}
+			for (i32 i = 0, c = anim.m_translations.size(); i < c; ++i) {
+				const i32 model_bone_index = translation_bones[i];
+				if (!isBound<use_mask>(model_bone_index, mask_bits)) continue;
 
-				const int model_bone_index = iter.value();
+				u32* cursor = translation_cursors ? &translation_cursors[i] : nullptr;
+				const Vec3 anim_pos = samplePosition(anim.m_translations[i], anim_t, frame_idx, frame_t, cursor);
 				if constexpr (use_weight) {
-					pos[model_bone_index] = lerp(pos[model_bone_index], anim_pos, weight);
+					push(pose, weighted_positions, model_bone_index, anim_pos, weight);
 				}
 				else {
 					pos[model_bone_index] = anim_pos;
 				}
 			}
+			if constexpr (use_weight) flush(pose, weighted_positions, weight);
 
-			for (const Animation::RotationCurve& curve : anim.m_rotations) {
-				Model::BoneMap::ConstIterator iter = model.getBoneIndex(curve.name);
-				if (!iter.isValid()) continue;
-				if constexpr(use_mask) {
-					if (mask->bones.find(curve.name) == mask->bones.end()) continue;
-				}
-
-				Quat anim_rot;
-				if(curve.times) {
-					u32 idx = 1;
-					for (u32 c = curve.count; idx < c; ++idx) {
-						if (curve.times[idx] > anim_t) break;
-					}
-					const float t = float(anim_t - curve.times[idx - 1]) / (curve.times[idx] - curve.times[idx - 1]);
-					anim_rot = nlerp(curve.rot[idx - 1], curve.rot[idx], t);
-				}
-				else {
-					anim_rot = nlerp(curve.rot[frame_idx], curve.rot[frame_idx + 1], frame_t);
-				}
+			for (i32 i = 0, c = anim.m_rotations.size(); i < c; ++i) {
+				const i32 model_bone_index = rotation_bones[i];
+				if (!isBound<use_mask>(model_bone_index, mask_bits)) continue;
 
-				const int model_bone_index = iter.value();
+				u32* cursor = rotation_cursors ? &rotation_cursors[i] : nullptr;
+				const Quat anim_rot = sampleRotation(anim.m_rotations[i], anim_t, frame_idx, frame_t, cursor);
 				if constexpr (use_weight) {
-					rot[model_bone_index] = nlerp(rot[model_bone_index], anim_rot, weight);
+					push(pose, weighted_rotations, model_bone_index, anim_rot, weight);
 				}
 				else {
 					rot[model_bone_index] = anim_rot;
 				}
 			}
+			if constexpr (use_weight) flush(pose, weighted_rotations, weight);
 		}
 		else {
-			for (const Animation::TranslationCurve& curve : anim.m_translations) {
-				Model::BoneMap::ConstIterator iter = model.getBoneIndex(curve.name);
-				if (!iter.isValid()) continue;
-				if constexpr(use_mask) {
-					if (mask->bones.find(curve.name) == mask->bones.end()) continue;
-				}
+			for (i32 i = 0, c = anim.m_translations.size(); i < c; ++i) {
+				const i32 model_bone_index = translation_bones[i];
+				if (!isBound<use_mask>(model_bone_index, mask_bits)) continue;
 
-				const int model_bone_index = iter.value();
+				const Animation::TranslationCurve& curve = anim.m_translations[i];
+				const Vec3 anim_pos = toVec3(decodePosition(curve, curve.count - 1));
 				if constexpr (use_weight) {
-					pos[model_bone_index] = lerp(pos[model_bone_index], curve.pos[curve.count - 1], weight);
+					push(pose, weighted_positions, model_bone_index, anim_pos, weight);
 				}
 				else {
-					pos[model_bone_index] = curve.pos[curve.count - 1];
+					pos[model_bone_index] = anim_pos;
 				}
 			}
+			if constexpr (use_weight) flush(pose, weighted_positions, weight);
 
-			for (const Animation::RotationCurve& curve : anim.m_rotations) {
-				Model::BoneMap::ConstIterator iter = model.getBoneIndex(curve.name);
-				if (!iter.isValid()) continue;
-				if constexpr(use_mask) {
-					if (mask->bones.find(curve.name) == mask->bones.end()) continue;
-				}
+			for (i32 i = 0, c = anim.m_rotations.size(); i < c; ++i) {
+				const i32 model_bone_index = rotation_bones[i];
+				if (!isBound<use_mask>(model_bone_index, mask_bits)) continue;
 
-				const int model_bone_index = iter.value();
+				const Animation::RotationCurve& curve = anim.m_rotations[i];
+				const Quat anim_rot = decodeRotation(curve, curve.count - 1);
 				if constexpr (use_weight) {
-					rot[model_bone_index] = nlerp(rot[model_bone_index], curve.rot[curve.count - 1], weight);
+					push(pose, weighted_rotations, model_bone_index, anim_rot, weight);
 				}
 				else {
-					rot[model_bone_index] = curve.rot[curve.count - 1];
+					rot[model_bone_index] = anim_rot;
 				}
 			}
+			if constexpr (use_weight) flush(pose, weighted_rotations, weight);
 		}
 	}
 }; // AnimationSampler
 
-void Animation::getRelativePose(Time time, Pose& pose, const Model& model, float weight, const BoneMask* mask) const {
+void Animation::getRelativePose(Time time, Pose& pose, const Model& model, float weight, const BoneMask* mask, Span<u32> key_cursors) const {
 	if (mask) {
 		if (weight < 0.9999f) {
-			AnimationSampler::getRelativePose<true, true>(*this, time, pose, model, weight, mask);
+			AnimationSampler::getRelativePose<true, true>(*this, time, pose, model, weight, mask, key_cursors);
 		}
 		else {
-			AnimationSampler::getRelativePose<true, false>(*this, time, pose, model, weight, mask);
+			AnimationSampler::getRelativePose<true, false>(*this, time, pose, model, weight, mask, key_cursors);
 		}
 	}
 	else {
 		if (weight < 0.9999f) {
-			AnimationSampler::getRelativePose<false, true>(*this, time, pose, model, weight, mask);
+			AnimationSampler::getRelativePose<false, true>(*this, time, pose, model, weight, mask, key_cursors);
 		}
 		else {
-			AnimationSampler::getRelativePose<false, false>(*this, time, pose, model, weight, mask);
+			AnimationSampler::getRelativePose<false, false>(*this, time, pose, model, weight, mask, key_cursors);
 		}
 	}
 }
 
+void Animation::getRelativePose(Time time, Pose& pose, const Model& model, float weight, const BoneMask* mask) const {
+	getRelativePose(time, pose, model, weight, mask, Span<u32>());
+}
+
 Vec3 Animation::getTranslation(Time time, u32 curve_idx) const
 {
 	const TranslationCurve& curve = m_translations[curve_idx];
 	if (time < m_length) {
 		const u64 anim_t_highres = ((u64)time.raw() << 16) / (m_length.raw());
 		ASSERT(anim_t_highres <= 0xffFF);
-		const u16 anim_t = u16(anim_t_highres);
-
-		if (curve.times) {
-			u32 idx = 1;
-			for (u32 c = curve.count; idx < c; ++idx) {
-				if (curve.times[idx] > anim_t) break;
-			}
-
-			const float t = float(anim_t - curve.times[idx - 1]) / (curve.times[idx] - curve.times[idx - 1]);
-			return lerp(curve.pos[idx - 1], curve.pos[idx], t);
-		}
-
 		const u64 frame_48_16 = (m_frame_count - 1) * anim_t_highres;
 		ASSERT((frame_48_16 & 0xffFF00000000) == 0);
 		const u32 frame_idx = u32(frame_48_16 >> 16);
 		const float frame_t = (frame_48_16 & 0xffFF) / float(0xffFF);
 
-		return lerp(curve.pos[frame_idx], curve.pos[frame_idx + 1], frame_t);
+		return AnimationSampler::samplePosition(curve, u16(anim_t_highres), frame_idx, frame_t, nullptr);
 	}
 
-	return curve.pos[curve.count - 1];
+	return AnimationSampler::toVec3(AnimationSampler::decodePosition(curve, curve.count - 1));
 }
 
 int Animation::getTranslationCurveIndex(BoneNameHash name_hash) const {
@@ -204,40 +400,30 @@ Quat Animation::getRotation(Time time, u32 curve_idx) const
 	if (time < m_length) {
 		const u64 anim_t_highres = ((u64)time.raw() << 16) / (m_length.raw());
 		ASSERT(anim_t_highres <= 0xffFF);
-		const u16 anim_t = u16(anim_t_highres);
-
-		if (curve.times) {
-			u32 idx = 1;
-			for (u32 c = curve.count; idx < c; ++idx) {
-				if (curve.times[idx] > anim_t) break;
-			}
-
-			const float t = float(anim_t - curve.times[idx - 1]) / (curve.times[idx] - curve.times[idx - 1]);
-			return nlerp(curve.rot[idx - 1], curve.rot[idx], t);
-		}
-
 		const u64 frame_48_16 = (m_frame_count - 1) * anim_t_highres;
 		ASSERT((frame_48_16 & 0xffFF00000000) == 0);
 		const u32 frame_idx = u32(frame_48_16 >> 16);
 		const float frame_t = (frame_48_16 & 0xffFF) / float(0xffFF);
 
-		return nlerp(curve.rot[frame_idx], curve.rot[frame_idx + 1], frame_t);
+		return AnimationSampler::sampleRotation(curve, u16(anim_t_highres), frame_idx, frame_t, nullptr);
 	}
 
-	return curve.rot[curve.count - 1];
+	return AnimationSampler::decodeRotation(curve, curve.count - 1);
 }
 
 void Animation::getRelativePose(Time time, Pose& pose, const Model& model, const BoneMask* mask) const {
 	if(mask) {
-		AnimationSampler::getRelativePose<true, false>(*this, time, pose, model, 1, mask);
+		AnimationSampler::getRelativePose<true, false>(*this, time, pose, model, 1, mask, Span<u32>());
 	}
 	else {
-		AnimationSampler::getRelativePose<false, false>(*this, time, pose, model, 1, mask);
+		AnimationSampler::getRelativePose<false, false>(*this, time, pose, model, 1, mask, Span<u32>());
 	}
 }
 
 bool Animation::load(u64 mem_size, const u8* mem)
 {
+	m_bindings_head = nullptr;
+	m_bindings.clear();
 	m_translations.clear();
 	m_rotations.clear();
 	m_mem.clear();
@@ -254,7 +440,7 @@ bool Animation::load(u64 mem_size, const u8* mem)
 		return false;
 	}
 
-	if (header.version <= Version::FIRST) {
+	if (header.version <= Version::QUANTIZED) {
 		logError(getPath(), ": version not supported. Please delete '.lumix' directory and try again");
 		return false;
 	}
@@ -264,8 +450,10 @@ bool Animation::load(u64 mem_size, const u8* mem)
 	u32 translations_count;
 	file.read(&translations_count, sizeof(translations_count));
 	const u32 size = u32(file.size() - file.getPosition());
-	m_mem.resize(size);
+	// decoder reads 4 u16 per key, including one past the last key
+	m_mem.resize(size + sizeof(u16) * 4);
 	file.read(&m_mem[0], size);
+	memset(&m_mem[size], 0, sizeof(u16) * 4);
 
 	m_translations.resize(translations_count);
 
@@ -276,8 +464,14 @@ bool Animation::load(u64 mem_size, const u8* mem)
 		const Animation::CurveType type = blob.read<Animation::CurveType>();
 		curve.count = blob.read<u32>();
 		ASSERT(curve.count > 1 || type != Animation::CurveType::KEYFRAMED);
+		ASSERT(curve.count == 1 || type != Animation::CurveType::CONSTANT);
 		curve.times = type == Animation::CurveType::KEYFRAMED ? (const u16*)blob.skip(curve.count * sizeof(u16)) : nullptr;
-		curve.pos = (const Vec3*)blob.skip(curve.count * sizeof(Vec3));
+		const Vec3 offset = blob.read<Vec3>();
+		const Vec3 scale = blob.read<Vec3>();
+		memcpy(curve.offset, &offset, sizeof(offset));
+		memcpy(curve.scale, &scale, sizeof(scale));
+		curve.offset[3] = curve.scale[3] = 0;
+		curve.pos = (const u16*)blob.skip(curve.count * sizeof(u16) * 3);
 	}
 	
 	const u32 rotations_count = blob.read<u32>();
@@ -289,8 +483,9 @@ bool Animation::load(u64 mem_size, const u8* mem)
 		const Animation::CurveType type = blob.read<Animation::CurveType>();
 		curve.count = blob.read<u32>();
 		ASSERT(curve.count > 1 || type != Animation::CurveType::KEYFRAMED);
+		ASSERT(curve.count == 1 || type != Animation::CurveType::CONSTANT);
 		curve.times = type == Animation::CurveType::KEYFRAMED ? (const u16*)blob.skip(curve.count * sizeof(u16)) : nullptr;
-		curve.rot = (const Quat*)blob.skip(curve.count * sizeof(Quat));
+		curve.rot = (const u16*)blob.skip(curve.count * sizeof(u16) * 3);
 	}
 
 	return true;
@@ -299,6 +494,8 @@ bool Animation::load(u64 mem_size, const u8* mem)
 
 void Animation::unload()
 {
+	m_bindings_head = nullptr;
+	m_bindings.clear();
 	m_translations.clear();
 	m_rotations.clear();
 	m_mem.clear();
@@ -1,9 +1,11 @@
 #pragma once
 
+#include "engine/allocator.h"
 #include "engine/hash.h"
 #include "engine/hash_map.h"
 #include "engine/resource.h"
 #include "engine/string.h"
+#include "engine/sync.h"
 
 namespace Lumix
 {
@@ -40,10 +42,29 @@ private:
 
 struct BoneMask
 {
-	BoneMask(IAllocator& allocator) : bones(allocator) {}
-	BoneMask(BoneMask&& rhs) = default;
+	enum { BITS_COUNT = 4 };
+
+	BoneMask(IAllocator& allocator) : bones(allocator), m_allocator(allocator), m_bits(allocator) {}
+	BoneMask(BoneMask&& rhs);
+	// one bit per model bone, set if the bone is in the mask; lock-free once computed for the skeleton
+	void getBits(const Model& model, u64 (&bits)[BITS_COUNT]) const;
+	// must be called after `bones` is changed, not while the mask is used
+	void invalidate();
+
 	StaticString<32> name;
 	HashMap<BoneNameHash, u8> bones;
+
+private:
+	struct Bits {
+		u32 skeleton_id;
+		u64 bits[BITS_COUNT];
+		Bits* next;
+	};
+	IAllocator& m_allocator;
+	// m_mutex guards only adding to m_bits, readers walk the immutable list from m_bits_head
+	mutable Mutex m_mutex;
+	mutable Array<UniquePtr<Bits>> m_bits;
+	mutable Bits* volatile m_bits_head = nullptr;
 };
 
 
@@ -56,11 +77,13 @@ struct Animation final : Resource
 	public:
 		enum class CurveType : u8 {
 			KEYFRAMED,
-			SAMPLED
+			SAMPLED,
+			CONSTANT
 		};
 
 		enum class Version : u32 {
 			FIRST = 3,
+			QUANTIZED,
 
 			LAST
 		};
@@ -83,32 +106,59 @@ struct Animation final : Resource
 		int getRotationCurveIndex(BoneNameHash name_hash) const;
 		void getRelativePose(Time time, Pose& pose, const Model& model, const BoneMask* mask) const;
 		void getRelativePose(Time time, Pose& pose, const Model& model, float weight, const BoneMask* mask) const;
+		// `key_cursors` has getCurvesCount() elements, it keeps the last sampled key of each curve between calls
+		void getRelativePose(Time time, Pose& pose, const Model& model, float weight, const BoneMask* mask, Span<u32> key_cursors) const;
+		u32 getCurvesCount() const { return m_translations.size() + m_rotations.size(); }
 		Time getLength() const { return m_length; }
 
 	private:
 		void unload() override;
 		bool load(u64 size, const u8* mem) override;
+		bool isLoadThreadSafe() const override { return true; }
 
 	private:
 		Time m_length;
+		// keys are 3 x u16, position = offset + key * scale
 		struct TranslationCurve
 		{
 			BoneNameHash name;
 			u32 count;
 			const u16* times;
-			const Vec3* pos;
+			const u16* pos;
+			float offset[4];
+			float scale[4];
 		};
+		// keys are 3 x u16, smallest three components of the quaternion:
+		// two 16bit and one 14bit, top 2 bits of the last u16 are the index of the omitted component
 		struct RotationCurve
 		{
 			BoneNameHash name;
 			u32 count;
 			const u16* times;
-			const Quat* rot;
+			const u16* rot;
 		};
+		// model bone index for each curve, -1 if the model does not have the bone;
+		// published once per skeleton, so lookups do not lock
+		struct BoneBinding
+		{
+			BoneBinding(IAllocator& allocator) : translations(allocator), rotations(allocator) {}
+			u32 skeleton_id;
+			Array<i16> translations;
+			Array<i16> rotations;
+			BoneBinding* next = nullptr;
+		};
+
+		const BoneBinding& getBinding(const Model& model) const;
+
+		IAllocator& m_allocator;
 		Array<TranslationCurve> m_translations;
 		Array<RotationCurve> m_rotations;
 		Array<u8> m_mem;
 		u32 m_frame_count = 0;
+		// guards only adding to m_bindings, readers walk the immutable list from m_bindings_head
+		mutable Mutex m_bindings_mutex;
+		mutable Array<UniquePtr<BoneBinding>> m_bindings;
+		mutable BoneBinding* volatile m_bindings_head = nullptr;
 
 		friend struct AnimationSampler;
 };
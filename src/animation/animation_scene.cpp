@@ -809,9 +809,11 @@ struct AnimationSceneImpl final : AnimationScene
 		PROFILE_FUNCTION();
 		if (m_animables.size() == 0) return;
 
-		jobs::forEach(m_animables.size(), 1, [&](i32 idx, i32){
-			Animable& animable = m_animables.at(idx);
-			updateAnimable(animable, time_delta);
+		jobs::parallelFor(m_animables.size(), [&](i32 from, i32 to){
+			for (i32 i = from; i < to; ++i) {
+				Animable& animable = m_animables.at(i);
+				updateAnimable(animable, time_delta);
+			}
 		});
 	}
 
@@ -825,8 +827,10 @@ struct AnimationSceneImpl final : AnimationScene
 		updateAnimables(time_delta);
 		updatePropertyAnimators(time_delta);
 
-		jobs::forEach(m_animators.size(), 1, [&](i32 idx, i32){
-			updateAnimator(m_animators[idx], time_delta);
+		jobs::parallelFor(m_animators.size(), [&](i32 from, i32 to){
+			for (i32 i = from; i < to; ++i) {
+				updateAnimator(m_animators[i], time_delta);
+			}
 		});
 	}
 
@@ -80,6 +80,7 @@ RuntimeContext::RuntimeContext(Controller& controller, IAllocator& allocator)
 	, inputs(allocator)
 	, controller(controller)
 	, animations(allocator)
+	, key_cursors(allocator)
 	, events(allocator)
 	, input_runtime(nullptr, 0)
 {
@@ -204,7 +205,18 @@ void Blend1DNode::skip(RuntimeContext& ctx) const {
 	ctx.input_runtime.skip(sizeof(float));
 }
 
-static void getPose(const RuntimeContext& ctx, float rel_time, float weight, u32 slot, Pose& pose, u32 mask_idx, bool looped) {
+static Span<u32> getKeyCursors(RuntimeContext& ctx, u32 slot, const Animation& anim) {
+	Array<u32>& cursors = ctx.key_cursors[slot];
+	const u32 count = anim.getCurvesCount();
+	if (cursors.size() < count) {
+		const u32 old_size = cursors.size();
+		cursors.resize(count);
+		for (u32 i = old_size; i < count; ++i) cursors[i] = 1;
+	}
+	return cursors;
+}
+
+static void getPose(RuntimeContext& ctx, float rel_time, float weight, u32 slot, Pose& pose, u32 mask_idx, bool looped) {
 	Animation* anim = ctx.animations[slot];
 	if (!anim) return;
 	if (!ctx.model->isReady()) return;
@@ -214,10 +226,10 @@ static void getPose(const RuntimeContext& ctx, float rel_time, float weight, u32
 	const Time anim_time = looped ? time % anim->getLength() : minimum(time, anim->getLength());
 
 	const BoneMask* mask = mask_idx < (u32)ctx.controller.m_bone_masks.size() ? &ctx.controller.m_bone_masks[mask_idx] : nullptr;
-	anim->getRelativePose(anim_time, pose, *ctx.model, weight, mask);
+	anim->getRelativePose(anim_time, pose, *ctx.model, weight, mask, getKeyCursors(ctx, slot, *anim));
 }
 
-static void getPose(const RuntimeContext& ctx, Time time, float weight, u32 slot, Pose& pose, u32 mask_idx, bool looped) {
+static void getPose(RuntimeContext& ctx, Time time, float weight, u32 slot, Pose& pose, u32 mask_idx, bool looped) {
 	Animation* anim = ctx.animations[slot];
 	if (!anim) return;
 	if (!ctx.model->isReady()) return;
@@ -226,7 +238,7 @@ static void getPose(const RuntimeContext& ctx, Time time, float weight, u32 slot
 	const Time anim_time = looped ? time % anim->getLength() : minimum(time, anim->getLength());
 
 	const BoneMask* mask = mask_idx < (u32)ctx.controller.m_bone_masks.size() ? &ctx.controller.m_bone_masks[mask_idx] : nullptr;
-	anim->getRelativePose(anim_time, pose, *ctx.model, weight, mask);
+	anim->getRelativePose(anim_time, pose, *ctx.model, weight, mask, getKeyCursors(ctx, slot, *anim));
 }
 
 void Blend1DNode::getPose(RuntimeContext& ctx, float weight, Pose& pose, u32 mask) const {
@@ -637,4 +649,4 @@ Node* Node::create(GroupNode* parent, Type type, IAllocator& allocator) {
 }
 
 
-} // namespace Lumix::anim
\ No newline at end of file
+} // namespace Lumix::anim
@@ -26,6 +26,8 @@ struct RuntimeContext {
 	Controller& controller;
 	Array<u8> inputs;
 	Array<Animation*> animations;
+	// per animation slot, last sampled key of each curve
+	Array<Array<u32>> key_cursors;
 	OutputMemoryStream data;
 	OutputMemoryStream events;
 	
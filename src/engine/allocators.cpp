@@ -14,6 +14,14 @@ namespace Lumix
 	static constexpr u32 PAGE_SIZE = 4096;
 	static constexpr size_t MAX_PAGE_COUNT = 16384;
 	static constexpr u32 SMALL_ALLOC_MAX_SIZE = 64;
+	static constexpr u32 BINS_COUNT = 4;
+	// threads over this limit use the global bins directly
+	static constexpr u32 MAX_THREAD_CACHES = 64;
+	static constexpr u32 THREAD_CACHE_SIZE = 32;
+	// items moved between a thread cache and the global bins under one lock
+	static constexpr u32 THREAD_CACHE_BATCH = 16;
+	// empty pages per bin which are not decommitted, so alloc/free around a page boundary does not syscall
+	static constexpr u32 MAX_EMPTY_PAGES = 4;
 
 	struct DefaultAllocator::Page {
 		struct Header {
@@ -21,6 +29,7 @@ namespace Lumix
 			Page* next;
 			u32 first_free;
 			u32 item_size;
+			u32 used_count;
 		};
 		u8 data[PAGE_SIZE - sizeof(Header)];
 		Header header;
@@ -28,6 +37,54 @@ namespace Lumix
 
 	static_assert(sizeof(DefaultAllocator::Page) == PAGE_SIZE);
 
+	// per-thread magazines, so most small allocations do not touch m_mutex
+	struct DefaultAllocator::ThreadCache {
+		void* items[BINS_COUNT][THREAD_CACHE_SIZE];
+		u32 counts[BINS_COUNT];
+	};
+
+	// guards g_allocators_with_caches and g_free_cache_slots, it's a spinlock since it's rarely taken
+	static volatile i32 g_caches_lock = 0;
+	static DefaultAllocator* g_allocators_with_caches = nullptr;
+	// cache slots of exited threads, reused by new threads
+	static u32 g_free_cache_slots[MAX_THREAD_CACHES];
+	static u32 g_free_cache_slots_count = 0;
+	static u32 g_thread_caches_count = 0;
+
+	struct CachesLockGuard {
+		CachesLockGuard() { while (!compareAndExchange(&g_caches_lock, 1, 0)) {} }
+		~CachesLockGuard() { compareAndExchange(&g_caches_lock, 0, 1); }
+	};
+
+	static void freeSmallLocked(DefaultAllocator& allocator, void* mem);
+
+	// returns cached items to global bins when the thread exits, so they are not stranded, and releases the slot
+	struct ThreadCacheSlot {
+		~ThreadCacheSlot() {
+			if (idx >= MAX_THREAD_CACHES) return;
+
+			CachesLockGuard lock;
+			for (DefaultAllocator* a = g_allocators_with_caches; a; a = a->m_next_with_caches) {
+				DefaultAllocator::ThreadCache& cache = a->m_thread_caches[idx];
+				MutexGuard guard(a->m_mutex);
+				for (u32 bin = 0; bin < BINS_COUNT; ++bin) {
+					for (u32 i = 0; i < cache.counts[bin]; ++i) {
+						freeSmallLocked(*a, cache.items[bin][i]);
+					}
+					cache.counts[bin] = 0;
+				}
+			}
+			g_free_cache_slots[g_free_cache_slots_count] = idx;
+			++g_free_cache_slots_count;
+		}
+
+		u32 idx = 0xffFFffFF;
+	};
+
+	static thread_local ThreadCacheSlot t_thread_cache;
+	static volatile i32 g_committed_pages = 0;
+	static volatile i32 g_global_bins_locks = 0;
+
 	static u32 sizeToBin(size_t n) {
 		ASSERT(n > 0);
 		ASSERT(n <= SMALL_ALLOC_MAX_SIZE);
@@ -46,6 +103,7 @@ namespace Lumix
 		page->header.prev = nullptr;
 		page->header.next = nullptr;
 		page->header.item_size = item_size;
+		page->header.used_count = 0;
 
 		for (u32 i = 0; i < sizeof(page->data) / item_size; ++i) {
 			*(u32*)&page->data[i * item_size] = u32(i * item_size + item_size);
@@ -56,21 +114,167 @@ namespace Lumix
 		return (DefaultAllocator::Page*)((uintptr)ptr & ~u64(PAGE_SIZE - 1));
 	}
 
-	static void freeSmall(DefaultAllocator& allocator, void* mem) {
+	static void unlinkPage(DefaultAllocator& allocator, u32 bin, DefaultAllocator::Page* p) {
+		if (allocator.m_free_lists[bin] == p) {
+			allocator.m_free_lists[bin] = p->header.next;
+		}
+		if (p->header.next) {
+			p->header.next->header.prev = p->header.prev;
+		}
+		if (p->header.prev) {
+			p->header.prev->header.next = p->header.next;
+		}
+		p->header.next = p->header.prev = nullptr;
+	}
+
+	// reuses pages returned to the OS before growing
+	static DefaultAllocator::Page* allocPage(DefaultAllocator& allocator) {
+		if (allocator.m_free_page_count > 0) {
+			for (u32 i = 0; i < lengthOf(allocator.m_free_pages); ++i) {
+				u64& bits = allocator.m_free_pages[i];
+				if (!bits) continue;
+				const u32 bit = countTrailingZeros(bits);
+				bits &= ~(u64(1) << bit);
+				--allocator.m_free_page_count;
+				return (DefaultAllocator::Page*)(allocator.m_small_allocations + PAGE_SIZE * (i * 64 + bit));
+			}
+			ASSERT(false);
+		}
+
+		if (allocator.m_page_count == MAX_PAGE_COUNT) return nullptr;
+		DefaultAllocator::Page* p = (DefaultAllocator::Page*)(allocator.m_small_allocations + PAGE_SIZE * allocator.m_page_count);
+		++allocator.m_page_count;
+		return p;
+	}
+
+	static void freePage(DefaultAllocator& allocator, DefaultAllocator::Page* p) {
+		const u32 idx = u32(((u8*)p - allocator.m_small_allocations) / PAGE_SIZE);
+		os::memDecommit(p, PAGE_SIZE);
+		allocator.m_free_pages[idx / 64] |= u64(1) << (idx % 64);
+		++allocator.m_free_page_count;
+		atomicDecrement(&g_committed_pages);
+	}
+
+	// m_mutex must be locked
+	static void freeSmallLocked(DefaultAllocator& allocator, void* mem) {
 		u8* ptr = (u8*)mem;
 		DefaultAllocator::Page* page = getPage(ptr);
+		const u32 bin = sizeToBin(page->header.item_size);
 		
-		MutexGuard guard(allocator.m_mutex);
 		if (page->header.first_free + page->header.item_size > sizeof(page->data)) {
 			ASSERT(!page->header.next);
 			ASSERT(!page->header.prev);
-			const u32 bin = sizeToBin(page->header.item_size);
 			page->header.next = allocator.m_free_lists[bin];
+			if (page->header.next) page->header.next->header.prev = page;
 			allocator.m_free_lists[bin] = page;
 		}
 
 		*(u32*)ptr = page->header.first_free;
 		page->header.first_free = u32(ptr - page->data);
+		--page->header.used_count;
+
+		if (page->header.used_count == 0) {
+			if (allocator.m_empty_page_counts[bin] < MAX_EMPTY_PAGES) {
+				++allocator.m_empty_page_counts[bin];
+			}
+			else {
+				unlinkPage(allocator, bin, page);
+				freePage(allocator, page);
+			}
+		}
+	}
+
+	// m_mutex must be locked
+	static void* allocSmallLocked(DefaultAllocator& allocator, u32 bin) {
+		if (!allocator.m_small_allocations) {
+			allocator.m_small_allocations = (u8*)os::memReserve(PAGE_SIZE * MAX_PAGE_COUNT);
+		}
+		DefaultAllocator::Page* p = allocator.m_free_lists[bin];
+		if (!p) {
+			p = allocPage(allocator);
+			if (!p) return nullptr;
+
+			initPage(8 << bin, p);
+			allocator.m_free_lists[bin] = p;
+			atomicIncrement(&g_committed_pages);
+		}
+		else if (p->header.used_count == 0) {
+			--allocator.m_empty_page_counts[bin];
+		}
+
+		ASSERT(p->header.item_size > 0);
+		ASSERT(p->header.first_free + p->header.item_size <= sizeof(p->data));
+		void* res = &p->data[p->header.first_free];
+		p->header.first_free = *(u32*)res;
+		++p->header.used_count;
+
+		const bool is_page_full = p->header.first_free + p->header.item_size > sizeof(p->data);
+		if (is_page_full) unlinkPage(allocator, bin, p);
+
+		return res;
+	}
+
+	static DefaultAllocator::ThreadCache* getThreadCache(DefaultAllocator& allocator) {
+		u32& idx = t_thread_cache.idx;
+		if (idx == 0xffFFffFF) {
+			CachesLockGuard lock;
+			if (g_free_cache_slots_count > 0) {
+				--g_free_cache_slots_count;
+				idx = g_free_cache_slots[g_free_cache_slots_count];
+			}
+			else {
+				idx = g_thread_caches_count;
+				++g_thread_caches_count;
+			}
+		}
+		if (idx >= MAX_THREAD_CACHES) return nullptr;
+
+		DefaultAllocator::ThreadCache* caches = allocator.m_thread_caches;
+		if (!caches) {
+			bool created = false;
+			{
+				MutexGuard guard(allocator.m_mutex);
+				if (!allocator.m_thread_caches) {
+					const size_t size = sizeof(DefaultAllocator::ThreadCache) * MAX_THREAD_CACHES;
+					// zero initialized by the OS
+					void* mem = os::memReserve(size);
+					os::memCommit(mem, size);
+					memoryBarrier();
+					allocator.m_thread_caches = (DefaultAllocator::ThreadCache*)mem;
+					created = true;
+				}
+				caches = allocator.m_thread_caches;
+			}
+			// outside of m_mutex, ThreadCacheSlot locks in the opposite order
+			if (created) {
+				CachesLockGuard lock;
+				allocator.m_next_with_caches = g_allocators_with_caches;
+				g_allocators_with_caches = &allocator;
+			}
+		}
+		return &caches[idx];
+	}
+
+	static void freeSmall(DefaultAllocator& allocator, void* mem) {
+		DefaultAllocator::ThreadCache* cache = getThreadCache(allocator);
+		if (!cache) {
+			MutexGuard guard(allocator.m_mutex);
+			freeSmallLocked(allocator, mem);
+			return;
+		}
+
+		const u32 bin = sizeToBin(getPage(mem)->header.item_size);
+		u32& count = cache->counts[bin];
+		if (count == THREAD_CACHE_SIZE) {
+			atomicIncrement(&g_global_bins_locks);
+			MutexGuard guard(allocator.m_mutex);
+			for (u32 i = THREAD_CACHE_SIZE - THREAD_CACHE_BATCH; i < THREAD_CACHE_SIZE; ++i) {
+				freeSmallLocked(allocator, cache->items[bin][i]);
+			}
+			count -= THREAD_CACHE_BATCH;
+		}
+		cache->items[bin][count] = mem;
+		++count;
 	}
 
 	static void* reallocSmall(DefaultAllocator& allocator, void* mem, size_t n) {
@@ -99,44 +303,30 @@ namespace Lumix
 		return new_mem;
 	}
 
+	// returns nullptr if all small pages are used
 	static void* allocSmall(DefaultAllocator& allocator, size_t n) {
 		const u32 bin = sizeToBin(n);
 
-		MutexGuard guard(allocator.m_mutex);
-
-		if (!allocator.m_small_allocations) {
-			allocator.m_small_allocations = (u8*)os::memReserve(PAGE_SIZE * MAX_PAGE_COUNT);
+		DefaultAllocator::ThreadCache* cache = getThreadCache(allocator);
+		if (!cache) {
+			MutexGuard guard(allocator.m_mutex);
+			return allocSmallLocked(allocator, bin);
 		}
-		DefaultAllocator::Page* p = allocator.m_free_lists[bin];
-		if (!p) {
-			if (allocator.m_page_count == MAX_PAGE_COUNT) return nullptr;
 
-			p = (DefaultAllocator::Page*)(allocator.m_small_allocations + PAGE_SIZE * allocator.m_page_count);
-			initPage(8 << bin, p);
-			allocator.m_free_lists[bin] = p;
-			++allocator.m_page_count;
-		}
-
-		ASSERT(p->header.item_size > 0);
-		ASSERT(p->header.first_free + n < sizeof(p->data));
-		void* res = &p->data[p->header.first_free];
-		p->header.first_free = *(u32*)res;
-
-		const bool is_page_full = p->header.first_free + p->header.item_size > sizeof(p->data);
-		if (is_page_full) {
-			if (allocator.m_free_lists[bin] == p) {
-				allocator.m_free_lists[bin] = p->header.next;
-			}
-			if (p->header.next) {
-				p->header.next->header.prev = p->header.prev;
+		u32& count = cache->counts[bin];
+		if (count == 0) {
+			atomicIncrement(&g_global_bins_locks);
+			MutexGuard guard(allocator.m_mutex);
+			for (u32 i = 0; i < THREAD_CACHE_BATCH; ++i) {
+				void* mem = allocSmallLocked(allocator, bin);
+				if (!mem) break;
+				cache->items[bin][count] = mem;
+				++count;
 			}
-			if (p->header.prev) {
-				p->header.prev->header.next = p->header.next;
-			}
-			p->header.next = p->header.prev = nullptr;
+			if (count == 0) return nullptr;
 		}
-
-		return res;
+		--count;
+		return cache->items[bin][count];
 	}
 
 	static bool isSmallAlloc(DefaultAllocator& allocator, void* p) {
@@ -146,16 +336,33 @@ namespace Lumix
 	DefaultAllocator::DefaultAllocator() {
 		m_page_count = 0;
 		memset(m_free_lists, 0, sizeof(m_free_lists));
+		memset(m_free_pages, 0, sizeof(m_free_pages));
 	}
 
 	DefaultAllocator::~DefaultAllocator() {
+		if (m_thread_caches) {
+			CachesLockGuard lock;
+			DefaultAllocator** iter = &g_allocators_with_caches;
+			while (*iter && *iter != this) iter = &(*iter)->m_next_with_caches;
+			if (*iter) *iter = m_next_with_caches;
+		}
 		os::memRelease(m_small_allocations, PAGE_SIZE * MAX_PAGE_COUNT);
+		if (m_thread_caches) {
+			os::memRelease(m_thread_caches, sizeof(ThreadCache) * MAX_THREAD_CACHES);
+		}
+	}
+
+	DefaultAllocator::Stats DefaultAllocator::getStats() {
+		Stats stats;
+		stats.committed_pages = g_committed_pages;
+		stats.global_bins_locks = g_global_bins_locks;
+		return stats;
 	}
 
 	void* DefaultAllocator::allocate(size_t n)
 	{
 		if (n <= SMALL_ALLOC_MAX_SIZE) {
-			return allocSmall(*this, n);
+			if (void* mem = allocSmall(*this, n)) return mem;
 		}
 		return malloc(n);
 	}
@@ -183,7 +390,7 @@ namespace Lumix
 	void* DefaultAllocator::allocate_aligned(size_t size, size_t align)
 	{
 		if (size <= SMALL_ALLOC_MAX_SIZE && align <= size) {
-			return allocSmall(*this, size);
+			if (void* mem = allocSmall(*this, size)) return mem;
 		}
 		return _aligned_malloc(size, align);
 	}
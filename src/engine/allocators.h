@@ -7,10 +7,20 @@ namespace Lumix {
 
 struct LUMIX_ENGINE_API DefaultAllocator final : IAllocator {
 	struct Page;
+	struct ThreadCache;
+
+	// totals over all instances
+	struct Stats {
+		u32 committed_pages;
+		// how many times a thread cache had to lock global bins
+		u32 global_bins_locks;
+	};
 
 	DefaultAllocator();
 	~DefaultAllocator();
 
+	static Stats getStats();
+
 	void* allocate(size_t n) override;
 	void deallocate(void* p) override;
 	void* reallocate(void* ptr, size_t size) override;
@@ -21,6 +31,14 @@ struct LUMIX_ENGINE_API DefaultAllocator final : IAllocator {
 	u8* m_small_allocations = nullptr;
 	Page* m_free_lists[4];
 	u32 m_page_count = 0;
+	// bitset of pages returned to the OS, which can be reused
+	u64 m_free_pages[16384 / 64];
+	u32 m_free_page_count = 0;
+	// empty pages kept committed in free lists, per bin
+	u32 m_empty_page_counts[4] = {};
+	ThreadCache* volatile m_thread_caches = nullptr;
+	// list of allocators with thread caches, exiting threads flush their cache in all of them
+	DefaultAllocator* m_next_with_caches = nullptr;
 	Mutex m_mutex;
 };
 
@@ -348,7 +348,15 @@ public:
 		const float reserved_pages_size = (m_page_allocator.getReservedCount() * PageAllocator::PAGE_SIZE) / (1024.f * 1024.f);
 		static u32 page_allocator_counter = profiler::createCounter("Page allocator (MB)", 0);
 		profiler::pushCounter(page_allocator_counter , reserved_pages_size);
-		
+
+		const DefaultAllocator::Stats alloc_stats = DefaultAllocator::getStats();
+		static u32 small_alloc_counter = profiler::createCounter("Small allocations (KB)", 0);
+		profiler::pushCounter(small_alloc_counter, alloc_stats.committed_pages * 4.f);
+		static u32 last_global_bins_locks = alloc_stats.global_bins_locks;
+		static u32 global_bins_locks_counter = profiler::createCounter("Small allocations locks", 0);
+		profiler::pushCounter(global_bins_locks_counter, float(alloc_stats.global_bins_locks - last_global_bins_locks));
+		last_global_bins_locks = alloc_stats.global_bins_locks;
+
 		#ifdef _WIN32
 			const float process_mem = os::getProcessMemory() / (1024.f * 1024.f);
 			static u32 process_mem_counter = profiler::createCounter("Process Memory (MB)", 0);
@@ -375,6 +383,8 @@ public:
 				scene->update(dt, m_paused);
 			}
 		}
+		// deferred local transforms set during update are visible in late update
+		context.updateWorldTransforms();
 		{
 			PROFILE_BLOCK("late update scenes");
 			for (UniquePtr<IScene>& scene : context.getScenes())
@@ -474,20 +484,48 @@ public:
 	{
 		SerializedEngineHeader header;
 		header.magic = SERIALIZED_ENGINE_MAGIC; // == '_LEN'
-		header.version = 0;
+		header.version = (u32)SerializedEngineVersion::LATEST;
 		serializer.write(header);
 		serializePluginList(serializer);
-		i32 pos = (i32)serializer.size();
 		ctx.serialize(serializer);
 		serializer.write((i32)ctx.getScenes().size());
 		for (UniquePtr<IScene>& scene : ctx.getScenes()) {
 			serializer.writeString(scene->getPlugin().getName());
 			serializer.write(scene->getVersion());
+			// size of the section, so scenes can be deserialized independently
+			const u64 size_pos = serializer.size();
+			serializer.write((u32)0);
 			scene->serialize(serializer);
+			const u32 size = u32(serializer.size() - size_pos - sizeof(u32));
+			memcpy(serializer.getMutableData() + size_pos, &size, sizeof(size));
 		}
 	}
 
 
+	// scenes are deserialized one by one on the calling thread, since deserialize loads resources
+	// and invokes component listeners
+	bool deserializeScenes(Universe& ctx, InputMemoryStream& serializer, const EntityMap& entity_map)
+	{
+		PROFILE_FUNCTION();
+		i32 scene_count;
+		serializer.read(scene_count);
+		for (i32 i = 0; i < scene_count; ++i) {
+			const char* name = serializer.readString();
+			const i32 version = serializer.read<i32>();
+			const u32 size = serializer.read<u32>();
+			const void* data = serializer.skip(size);
+			IScene* scene = ctx.getScene(name);
+			if (!scene) {
+				logWarning("Skipping unknown scene ", name);
+				continue;
+			}
+			InputMemoryStream blob(data, size);
+			scene->deserialize(blob, entity_map, version);
+		}
+		return true;
+	}
+
+
 	bool deserialize(Universe& ctx, InputMemoryStream& serializer, EntityMap& entity_map) override
 	{
 		SerializedEngineHeader header;
@@ -497,9 +535,16 @@ public:
 			logError("Wrong or corrupted file");
 			return false;
 		}
+		if (header.version > (u32)SerializedEngineVersion::LATEST) {
+			logError("Unsupported version");
+			return false;
+		}
 		if (!hasSerializedPlugins(serializer)) return false;
 
-		ctx.deserialize(serializer, entity_map);
+		const SerializedEngineVersion version = (SerializedEngineVersion)header.version;
+		ctx.deserialize(serializer, entity_map, version);
+		if (version > SerializedEngineVersion::CHUNKED) return deserializeScenes(ctx, serializer, entity_map);
+
 		i32 scene_count;
 		serializer.read(scene_count);
 		for (int i = 0; i < scene_count; ++i)
@@ -9,6 +9,13 @@ namespace Lumix {
 
 namespace os { using WindowHandle = void*; }
 
+// version of data written by Engine::serialize
+enum class SerializedEngineVersion : u32 {
+	CHUNKED, // universe in bulk arrays, scene sections with sizes
+
+	LATEST
+};
+
 enum class DeserializeProjectResult {
 	SUCCESS,
 	CORRUPTED_FILE,
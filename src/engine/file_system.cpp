@@ -30,12 +30,55 @@ struct AsyncItem {
 
 	FileSystem::ContentCallback callback;
 	OutputMemoryStream data;
+	// zero-copy content pointing to a mapped file, used instead of `data` if not empty
+	Span<const u8> mapped;
 	StaticString<LUMIX_MAX_PATH> path;
 	u32 id = 0;
 	FlagSet<Flags, u32> flags;
 };
 
 
+// FIFO, pop only moves the head, so both push and pop are O(1)
+// popped slots are reclaimed once the queue drains or once they are the majority
+struct AsyncQueue {
+	explicit AsyncQueue(IAllocator& allocator) : m_items(allocator) {}
+
+	bool empty() const { return m_head == m_items.size(); }
+	AsyncItem& push(AsyncItem&& item) { return m_items.emplace(static_cast<AsyncItem&&>(item)); }
+	AsyncItem& push(IAllocator& allocator) { return m_items.emplace(allocator); }
+
+	AsyncItem pop() {
+		ASSERT(!empty());
+		AsyncItem item = static_cast<AsyncItem&&>(m_items[m_head]);
+		++m_head;
+		if (m_head == m_items.size()) {
+			m_items.clear();
+			m_head = 0;
+		}
+		else if (m_head >= 64 && m_head * 2 > m_items.size()) {
+			const u32 count = m_items.size() - m_head;
+			for (u32 i = 0; i < count; ++i) {
+				m_items[i] = static_cast<AsyncItem&&>(m_items[m_head + i]);
+			}
+			while (m_items.size() > count) m_items.pop();
+			m_head = 0;
+		}
+		return item;
+	}
+
+	AsyncItem* find(u32 id) {
+		for (u32 i = m_head, c = m_items.size(); i < c; ++i) {
+			if (m_items[i].id == id) return &m_items[i];
+		}
+		return nullptr;
+	}
+
+private:
+	Array<AsyncItem> m_items;
+	u32 m_head = 0;
+};
+
+
 struct FileSystemImpl;
 
 
@@ -43,6 +86,7 @@ struct FSTask final : Thread {
 	FSTask(FileSystemImpl& fs, IAllocator& allocator)
 		: Thread(allocator)
 		, m_fs(fs)
+		, m_item(allocator)
 	{}
 
 	~FSTask() = default;
@@ -50,6 +94,9 @@ struct FSTask final : Thread {
 	void stop();
 	int task() override;
 
+	// request being read by this thread, id == 0 if none; guarded by FileSystemImpl::m_mutex
+	AsyncItem m_item;
+
 private:
 	FileSystemImpl& m_fs;
 	bool m_finish = false;
@@ -57,22 +104,32 @@ private:
 
 
 struct FileSystemImpl : FileSystem {
-	explicit FileSystemImpl(const char* base_path, IAllocator& allocator)
+	explicit FileSystemImpl(const char* base_path, IAllocator& allocator, u32 threads_count)
 		: m_allocator(allocator)
-		, m_queue(allocator)	
+		, m_tasks(allocator)
+		, m_queues{AsyncQueue(allocator), AsyncQueue(allocator), AsyncQueue(allocator)}
 		, m_finished(allocator)	
+		, m_work(allocator)
 		, m_last_id(0)
 		, m_semaphore(0, 0xffFF)
 	{
+		static_assert((u32)Priority::COUNT == 3);
 		setBasePath(base_path);
-		m_task.create(*this, m_allocator);
-		m_task->create("Filesystem", true);
+		for (u32 i = 0; i < threads_count; ++i) {
+			FSTask* task = LUMIX_NEW(m_allocator, FSTask)(*this, m_allocator);
+			m_tasks.push(task);
+			task->create("Filesystem", true);
+		}
 	}
 
 	~FileSystemImpl() override {
-		m_task->stop();
-		m_task->destroy();
-		m_task.destroy();
+		// stop all tasks before waking any, otherwise a task could try to pop a request that does not exist
+		for (FSTask* task : m_tasks) task->stop();
+		for (u32 i = 0; i < (u32)m_tasks.size(); ++i) m_semaphore.signal();
+		for (FSTask* task : m_tasks) {
+			task->destroy();
+			LUMIX_DELETE(m_allocator, task);
+		}
 	}
 
 
@@ -107,16 +164,17 @@ struct FileSystemImpl : FileSystem {
 		return true;
 	}
 
-	AsyncHandle getContent(const Path& file, const ContentCallback& callback) override
+	bool hasPersistentContent() const override { return false; }
+
+	AsyncHandle getContent(const Path& file, const ContentCallback& callback, Priority priority) override
 	{
 		if (file.isEmpty()) return AsyncHandle::invalid();
+		ASSERT(priority < Priority::COUNT);
 
 		MutexGuard lock(m_mutex);
 		++m_work_counter;
-		AsyncItem& item = m_queue.emplace(m_allocator);
-		++m_last_id;
-		if (m_last_id == 0) ++m_last_id;
-		item.id = m_last_id;
+		AsyncItem& item = m_queues[(u32)priority].push(m_allocator);
+		item.id = generateID();
 		item.path = file.c_str();
 		item.callback = callback;
 		m_semaphore.signal();
@@ -124,22 +182,78 @@ struct FileSystemImpl : FileSystem {
 	}
 
 
+	// for content already in memory, callback is still called from processCallbacks like for any other request
+	AsyncHandle pushFinished(const Path& file, const ContentCallback& callback, Span<const u8> content, bool success) {
+		MutexGuard lock(m_mutex);
+		++m_work_counter;
+		AsyncItem& item = m_finished.push(m_allocator);
+		item.id = generateID();
+		item.path = file.c_str();
+		item.callback = callback;
+		item.mapped = content;
+		if (!success) item.flags.set(AsyncItem::Flags::FAILED);
+		return AsyncHandle(item.id);
+	}
+
+
+	AsyncHandle beginWork(const ContentCallback& callback) override {
+		MutexGuard lock(m_mutex);
+		++m_work_counter;
+		AsyncItem& item = m_work.emplace(m_allocator);
+		item.id = generateID();
+		item.callback = callback;
+		return AsyncHandle(item.id);
+	}
+
+
+	void finishWork(AsyncHandle handle) override {
+		MutexGuard lock(m_mutex);
+		for (u32 i = 0, c = m_work.size(); i < c; ++i) {
+			if (m_work[i].id != handle.value) continue;
+			if (!m_work[i].isCanceled()) m_finished.push(static_cast<AsyncItem&&>(m_work[i]));
+			m_work.swapAndPop(i);
+			return;
+		}
+		ASSERT(false);
+	}
+
+
+	// m_mutex must be locked
+	u32 generateID() {
+		++m_last_id;
+		if (m_last_id == 0) ++m_last_id;
+		return m_last_id;
+	}
+
+
 	void cancel(AsyncHandle async) override
 	{
 		MutexGuard lock(m_mutex);
-		for (AsyncItem& item : m_queue) {
-			if (item.id == async.value) {
-				item.flags.set(AsyncItem::Flags::CANCELED);
+		for (AsyncQueue& queue : m_queues) {
+			if (AsyncItem* item = queue.find(async.value)) {
+				item->flags.set(AsyncItem::Flags::CANCELED);
+				--m_work_counter;
+				return;
+			}
+		}
+		for (FSTask* task : m_tasks) {
+			if (task->m_item.id == async.value) {
+				task->m_item.flags.set(AsyncItem::Flags::CANCELED);
 				--m_work_counter;
 				return;
 			}
 		}
-		for (AsyncItem& item : m_finished) {
+		for (AsyncItem& item : m_work) {
 			if (item.id == async.value) {
 				item.flags.set(AsyncItem::Flags::CANCELED);
+				--m_work_counter;
 				return;
 			}
 		}
+		if (AsyncItem* item = m_finished.find(async.value)) {
+			item->flags.set(AsyncItem::Flags::CANCELED);
+			return;
+		}
 		ASSERT(false);
 	}
 
@@ -235,15 +349,15 @@ struct FileSystemImpl : FileSystem {
 				break;
 			}
 
-			AsyncItem item = static_cast<AsyncItem&&>(m_finished[0]);
-			m_finished.erase(0);
+			AsyncItem item = m_finished.pop();
 			ASSERT(m_work_counter > 0);
 			--m_work_counter;
 
 			m_mutex.exit();
 
 			if(!item.isCanceled()) {
-				item.callback.invoke(item.data.size(), (const u8*)item.data.data(), !item.isFailed());
+				const Span<const u8> content = item.mapped.length() > 0 ? item.mapped : (Span<const u8>)item.data;
+				item.callback.invoke(content.length(), content.begin(), !item.isFailed());
 			}
 
 			if (timer.getTimeSinceStart() > 0.1f) {
@@ -252,12 +366,23 @@ struct FileSystemImpl : FileSystem {
 		}
 	}
 
+	// called by FSTask, m_mutex must be locked
+	AsyncItem popPending() {
+		for (AsyncQueue& queue : m_queues) {
+			if (!queue.empty()) return queue.pop();
+		}
+		ASSERT(false);
+		return AsyncItem(m_allocator);
+	}
+
 	IAllocator& m_allocator;
-	Local<FSTask> m_task;
+	Array<FSTask*> m_tasks;
 	StaticString<LUMIX_MAX_PATH> m_base_path;
-	Array<AsyncItem> m_queue;
+	AsyncQueue m_queues[(u32)Priority::COUNT];
 	u32 m_work_counter = 0;
-	Array<AsyncItem> m_finished;
+	AsyncQueue m_finished;
+	// started by beginWork, waiting for finishWork
+	Array<AsyncItem> m_work;
 	Mutex m_mutex;
 	Semaphore m_semaphore;
 
@@ -273,13 +398,14 @@ int FSTask::task()
 
 		StaticString<LUMIX_MAX_PATH> path;
 		{
+			// each signal matches one pending request, so there's always something to pop
 			MutexGuard lock(m_fs.m_mutex);
-			ASSERT(!m_fs.m_queue.empty());
-			path = m_fs.m_queue[0].path;
-			if (m_fs.m_queue[0].isCanceled()) {
-				m_fs.m_queue.erase(0);
+			m_item = m_fs.popPending();
+			if (m_item.isCanceled()) {
+				m_item.id = 0;
 				continue;
 			}
+			path = m_item.path;
 		}
 
 		OutputMemoryStream data(m_fs.m_allocator);
@@ -287,14 +413,14 @@ int FSTask::task()
 
 		{
 			MutexGuard lock(m_fs.m_mutex);
-			if (!m_fs.m_queue[0].isCanceled()) {
-				m_fs.m_finished.emplace(static_cast<AsyncItem&&>(m_fs.m_queue[0]));
-				m_fs.m_finished.back().data = static_cast<OutputMemoryStream&&>(data);
+			if (!m_item.isCanceled()) {
+				m_item.data = static_cast<OutputMemoryStream&&>(data);
 				if(!success) {
-					m_fs.m_finished.back().flags.set(AsyncItem::Flags::FAILED);
+					m_item.flags.set(AsyncItem::Flags::FAILED);
 				}
+				m_fs.m_finished.push(static_cast<AsyncItem&&>(m_item));
 			}
-			m_fs.m_queue.erase(0);
+			m_item.id = 0;
 		}
 	}
 	return 0;
@@ -304,33 +430,36 @@ int FSTask::task()
 void FSTask::stop()
 {
 	m_finish = true;
-	m_fs.m_semaphore.signal();
 }
 
+// the whole pak is mapped to memory, so reads need no locks and async reads need no copies or I/O threads
 struct PackFileSystem : FileSystemImpl {
 	PackFileSystem(const char* pak_path, IAllocator& allocator) 
-		: FileSystemImpl("pack://", allocator) 
+		: FileSystemImpl("pack://", allocator, 0) 
 		, m_map(allocator)
 	{
 		if (!m_file.open(pak_path)) {
 			logError("Failed to open game.pak");
 			return;
 		}
-		const u32 count = m_file.read<u32>();
+		InputMemoryStream header(m_file.data(), m_file.size());
+		const u32 count = header.read<u32>();
 		for (u32 i = 0; i < count; ++i) {
-			const FilePathHash hash = m_file.read<FilePathHash>();
+			const FilePathHash hash = header.read<FilePathHash>();
 			PackFile& f = m_map.insert(hash);
-			f.offset = m_file.read<u64>();
-			f.size = m_file.read<u64>();
+			f.offset = header.read<u64>();
+			f.size = header.read<u64>();
 		}
+		// offsets are relative to the end of the header
+		m_data_offset = header.getPosition();
 	}
 
 	~PackFileSystem() {
 		m_file.close();
 	}
 
-	bool getContentSync(const Path& path, OutputMemoryStream& content) override {
-		ASSERT(content.size() == 0);
+	// returns false if the file is not in the pak
+	bool getMappedContent(const Path& path, Span<const u8>& content) {
 		Span<const char> basename = Path::getBasename(path.c_str());
 		u64 hashu64;
 		fromCString(basename, hashu64);
@@ -344,16 +473,33 @@ struct PackFileSystem : FileSystemImpl {
 			if (!iter.isValid()) return false;
 		}
 
-		content.resize(iter.value().size);
-		MutexGuard lock(m_mutex);
-		const u32 header_size = sizeof(u32) + m_map.size() * (2 * sizeof(u64) + sizeof(u32));
-		if (!m_file.seek(iter.value().offset + header_size) || !m_file.read(content.getMutableData(), content.size())) {
+		const PackFile& f = iter.value();
+		if (m_data_offset + f.offset + f.size > m_file.size()) {
 			logError("Could not read ", path);
 			return false;
 		}
+		const u8* data = m_file.data() + m_data_offset + f.offset;
+		content = Span(data, (u32)f.size);
+		return true;
+	}
 
+	bool getContentSync(const Path& path, OutputMemoryStream& content) override {
+		ASSERT(content.size() == 0);
+		Span<const u8> mapped;
+		if (!getMappedContent(path, mapped)) return false;
+		content.write(mapped.begin(), mapped.length());
 		return true;
 	}
+
+	// the mapping lives as long as the file system
+	bool hasPersistentContent() const override { return true; }
+
+	AsyncHandle getContent(const Path& path, const ContentCallback& callback, Priority priority) override {
+		if (path.isEmpty()) return AsyncHandle::invalid();
+		Span<const u8> mapped;
+		const bool success = getMappedContent(path, mapped);
+		return pushFinished(path, callback, mapped, success);
+	}
 	
 	struct PackFile {
 		u64 offset;
@@ -361,13 +507,15 @@ struct PackFileSystem : FileSystemImpl {
 	};
 
 	HashMap<FilePathHash, PackFile> m_map;
-	os::InputFile m_file;
+	os::MappedFile m_file;
+	u64 m_data_offset = 0;
 };
 
 
-UniquePtr<FileSystem> FileSystem::create(const char* base_path, IAllocator& allocator)
+UniquePtr<FileSystem> FileSystem::create(const char* base_path, IAllocator& allocator, u32 threads_count)
 {
-	return UniquePtr<FileSystemImpl>::create(allocator, base_path, allocator);
+	ASSERT(threads_count > 0);
+	return UniquePtr<FileSystemImpl>::create(allocator, base_path, allocator, threads_count);
 }
 
 UniquePtr<FileSystem> FileSystem::createPacked(const char* pak_path, IAllocator& allocator)
@@ -16,6 +16,17 @@ namespace os {
 struct LUMIX_ENGINE_API FileSystem {
 	using ContentCallback = Delegate<void(u64, const u8*, bool)>;
 
+	// requests with higher priority are read first, requests with the same priority in FIFO order
+	enum class Priority : u8 {
+		HIGH,
+		NORMAL,
+		LOW,
+
+		COUNT
+	};
+
+	static constexpr u32 DEFAULT_THREADS_COUNT = 2;
+
 	struct LUMIX_ENGINE_API AsyncHandle {
 		static AsyncHandle invalid() { return AsyncHandle(0xffFFffFF); }
 		explicit AsyncHandle(u32 value) : value(value) {}
@@ -23,7 +34,7 @@ struct LUMIX_ENGINE_API FileSystem {
 		bool isValid() const { return value != 0xffFFffFF; }
 	};
 
-	static UniquePtr<FileSystem> create(const char* base_path, struct IAllocator& allocator);
+	static UniquePtr<FileSystem> create(const char* base_path, struct IAllocator& allocator, u32 threads_count = DEFAULT_THREADS_COUNT);
 	static UniquePtr<FileSystem> createPacked(const char* pak_path, struct IAllocator& allocator);
 
 	virtual ~FileSystem() {}
@@ -45,8 +56,17 @@ struct LUMIX_ENGINE_API FileSystem {
 	virtual void makeAbsolute(Span<char> absolute, const char* relative) const = 0;
 
 	[[nodiscard]] virtual bool getContentSync(const struct Path& file, struct OutputMemoryStream& content) =  0;
-	virtual AsyncHandle getContent(const Path& file, const ContentCallback& callback) = 0;
+	virtual AsyncHandle getContent(const Path& file, const ContentCallback& callback, Priority priority) = 0;
 	virtual void cancel(AsyncHandle handle) = 0;
+	// true if content passed to ContentCallback stays valid while the file system exists (mapped pak),
+	// otherwise it's valid only during the callback
+	virtual bool hasPersistentContent() const = 0;
+
+	// for work started from a content callback, e.g. decompression on a job worker;
+	// hasWork() is true until `callback` is called from processCallbacks, which happens after finishWork
+	virtual AsyncHandle beginWork(const ContentCallback& callback) = 0;
+	// can be called from any thread
+	virtual void finishWork(AsyncHandle handle) = 0;
 };
 
 } // namespace Lumix
@@ -23,10 +23,152 @@ struct Job {
 
 struct WorkerTask;
 
+// Chase-Lev work-stealing deque, owner pushes and pops at the bottom, thieves steal from the top
+struct WorkStealingQueue {
+	enum { CAPACITY = 4096 };
+
+	// owner only, returns false if the queue is full
+	bool push(const Job& job) {
+		const i64 b = m_bottom;
+		const i64 t = m_top;
+		if (b - t >= CAPACITY) return false;
+		m_jobs[b & (CAPACITY - 1)] = job;
+		memoryBarrier();
+		m_bottom = b + 1;
+		return true;
+	}
+
+	// owner only
+	bool pop(Job& job) {
+		const i64 b = m_bottom - 1;
+		m_bottom = b;
+		memoryBarrier();
+		const i64 t = m_top;
+		if (t > b) {
+			m_bottom = b + 1;
+			return false;
+		}
+		
+		job = m_jobs[b & (CAPACITY - 1)];
+		if (t != b) return true;
+
+		// last job, race with thieves
+		const bool res = compareAndExchange64(&m_top, t + 1, t);
+		m_bottom = t + 1;
+		return res;
+	}
+
+	// any thread
+	bool steal(Job& job) {
+		const i64 t = m_top;
+		memoryBarrier();
+		const i64 b = m_bottom;
+		if (t >= b) return false;
+
+		// acquire, pairs with the barrier in push, otherwise weakly ordered CPUs (ARM) can read the slot before it's written
+		memoryBarrier();
+		job = m_jobs[t & (CAPACITY - 1)];
+		return compareAndExchange64(&m_top, t + 1, t);
+	}
+
+	// any thread, only a hint
+	bool isEmpty() const { return m_top >= m_bottom; }
+
+	volatile i64 m_top = 0;
+	volatile i64 m_bottom = 0;
+	Job m_jobs[CAPACITY];
+};
+
+static_assert((WorkStealingQueue::CAPACITY & (WorkStealingQueue::CAPACITY - 1)) == 0, "Capacity must be power of 2");
+
+// bump allocator, one per fiber, since a job stays on its fiber even when it waits
+// (so it can not be per worker); bigger requests fall back to the job system's allocator
+struct ScratchAllocator final : IAllocator {
+	static constexpr u32 RESERVED_SIZE = 8 * 1024 * 1024;
+	static constexpr u32 COMMIT_STEP = 64 * 1024;
+	// memory above this is decommitted once the allocator is empty, so a single big job does not pin it forever
+	static constexpr u32 KEEP_COMMITED = 256 * 1024;
+	static constexpr u32 NO_ALLOCATION = 0xffFFffFF;
+
+	~ScratchAllocator() {
+		if (m_mem) os::memRelease(m_mem, RESERVED_SIZE);
+	}
+
+	bool owns(void* ptr) const { return ptr >= m_mem && ptr < m_mem + RESERVED_SIZE; }
+
+	void reset(u32 top) {
+		m_top = top;
+		m_last = NO_ALLOCATION;
+		if (top == 0 && m_commited > KEEP_COMMITED) {
+			os::memDecommit(m_mem + KEEP_COMMITED, m_commited - KEEP_COMMITED);
+			m_commited = KEEP_COMMITED;
+		}
+	}
+
+	void* allocate_aligned(size_t size, size_t align) override {
+		if (!m_mem) m_mem = (u8*)os::memReserve(RESERVED_SIZE);
+
+		const u32 start = u32((m_top + align - 1) & ~(align - 1));
+		if (start + size > RESERVED_SIZE) return getAllocator().allocate_aligned(size, align);
+
+		const u32 end = start + u32(size);
+		if (end > m_commited) {
+			const u32 commited = minimum((end + COMMIT_STEP - 1) & ~(COMMIT_STEP - 1), RESERVED_SIZE);
+			os::memCommit(m_mem + m_commited, commited - m_commited);
+			m_commited = commited;
+		}
+		m_last = start;
+		m_top = end;
+		return m_mem + start;
+	}
+
+	// only the last allocation is actually freed, the rest is freed by ScratchScope or when the job finishes
+	void deallocate_aligned(void* ptr) override {
+		if (!ptr) return;
+		if (!owns(ptr)) {
+			getAllocator().deallocate_aligned(ptr);
+			return;
+		}
+		if (u32((u8*)ptr - m_mem) == m_last) {
+			m_top = m_last;
+			m_last = NO_ALLOCATION;
+		}
+	}
+
+	void* reallocate_aligned(void* ptr, size_t size, size_t align) override {
+		if (!ptr) return allocate_aligned(size, align);
+		if (!owns(ptr)) return getAllocator().reallocate_aligned(ptr, size, align);
+
+		const u32 offset = u32((u8*)ptr - m_mem);
+		if (offset == m_last && (offset & (align - 1)) == 0 && offset + size <= RESERVED_SIZE) {
+			// grow in place
+			m_top = offset;
+			return allocate_aligned(size, align);
+		}
+		// size of the old allocation is unknown, but nothing after it is past m_top
+		const u32 old_top = m_top;
+		void* new_mem = allocate_aligned(size, align);
+		memcpy(new_mem, ptr, minimum(size, size_t(old_top - offset)));
+		return new_mem;
+	}
+
+	void* allocate(size_t size) override { return allocate_aligned(size, 16); }
+	void deallocate(void* ptr) override { deallocate_aligned(ptr); }
+	void* reallocate(void* ptr, size_t size) override { return reallocate_aligned(ptr, size, 16); }
+
+	u8* m_mem = nullptr;
+	u32 m_top = 0;
+	u32 m_commited = 0;
+	u32 m_last = NO_ALLOCATION;
+};
+
 struct FiberDecl {
 	int idx;
 	Fiber::Handle fiber = Fiber::INVALID_FIBER;
 	Job current_job;
+	ScratchAllocator scratch;
+	// a fiber waits on at most one signal, this links fibers waiting on the same signal
+	FiberDecl* next_waitor = nullptr;
 };
 
 #ifdef _WIN32
@@ -44,17 +186,24 @@ struct System
 		, m_ready_fibers(allocator)
 		, m_free_fibers(allocator)
 		, m_backup_workers(allocator)
+		, m_sleeping_workers(allocator)
 	{}
 
 
 	Lumix::Mutex m_sync;
+	// guards m_job_queue, m_ready_fibers, m_sleeping_workers and pinned queues of workers
 	Lumix::Mutex m_job_queue_sync;
 	Array<WorkerTask*> m_workers;
 	Array<WorkerTask*> m_backup_workers;
+	Array<WorkerTask*> m_sleeping_workers;
+	// jobs pushed from threads without own work-stealing queue and overflow
 	Array<Job> m_job_queue;
 	FiberDecl m_fiber_pool[512];
 	Array<FiberDecl*> m_free_fibers;
 	Array<FiberDecl*> m_ready_fibers;
+	volatile i32 m_sleeping_count = 0;
+	// m_job_queue.size() + m_ready_fibers.size(), can be read without lock
+	volatile i32 m_global_work_count = 0;
 	IAllocator& m_allocator;
 };
 
@@ -78,9 +227,17 @@ struct WorkerTask : Thread
 		, m_worker_index(worker_index)
 		, m_job_queue(system.m_allocator)
 		, m_ready_fibers(system.m_allocator)
+		, m_rng_state(worker_index * 2654435761 + 1)
 	{
 	}
 
+	u32 randomVictim(u32 count) {
+		m_rng_state ^= m_rng_state << 13;
+		m_rng_state ^= m_rng_state >> 17;
+		m_rng_state ^= m_rng_state << 5;
+		return m_rng_state % count;
+	}
+
 
 	int task() override
 	{
@@ -112,64 +269,123 @@ struct WorkerTask : Thread
 	FiberDecl* m_current_fiber = nullptr;
 	Fiber::Handle m_primary_fiber;
 	System& m_system;
+	WorkStealingQueue m_work_queue;
+	// jobs and fibers pinned to this worker, guarded by m_job_queue_sync
 	Array<Job> m_job_queue;
 	Array<FiberDecl*> m_ready_fibers;
+	// m_job_queue.size() + m_ready_fibers.size(), can be read without lock
+	volatile i32 m_pinned_work_count = 0;
+	u32 m_rng_state;
 	u8 m_worker_index;
 	bool m_is_enabled = false;
 	bool m_is_backup = false;
+	bool m_is_sleeping = false;
 };
 
-struct Waitor {
-	Waitor* next;
-	FiberDecl* fiber;
-};
+// call with m_job_queue_sync locked
+static void removeSleepingWorker(WorkerTask* worker) {
+	if (!worker->m_is_sleeping) return;
+	worker->m_is_sleeping = false;
+	g_system->m_sleeping_workers.swapAndPopItem(worker);
+	atomicDecrement(&g_system->m_sleeping_count);
+}
+
+// call with m_job_queue_sync locked
+static void wakeupWorker(WorkerTask* worker) {
+	if (!worker->m_is_sleeping) return;
+	removeSleepingWorker(worker);
+	worker->wakeup();
+}
+
+// call with m_job_queue_sync locked
+static void wakeupOneWorker() {
+	while (!g_system->m_sleeping_workers.empty()) {
+		WorkerTask* worker = g_system->m_sleeping_workers.back();
+		wakeupWorker(worker);
+		// disabled backup worker does not take jobs, so wake someone else too
+		if (!worker->m_is_backup || worker->m_is_enabled) return;
+	}
+}
+
+static bool isAnyQueueStealable() {
+	for (WorkerTask* worker : g_system->m_workers) {
+		if (!worker->m_work_queue.isEmpty()) return true;
+	}
+	return false;
+}
+
+static bool steal(WorkerTask* thief, Job& job) {
+	const u32 count = g_system->m_workers.size();
+	if (count == 0) return false;
+	const u32 start = thief->randomVictim(count);
+	for (u32 i = 0; i < count; ++i) {
+		WorkerTask* victim = g_system->m_workers[(start + i) % count];
+		if (victim == thief) continue;
+		// retry while there's something to steal, failed steal means some other thread made progress
+		while (!victim->m_work_queue.isEmpty()) {
+			if (victim->m_work_queue.steal(job)) return true;
+		}
+	}
+	return false;
+}
+
+// Signal::state packs the counter in low bits and index + 1 of the first waiting fiber in high bits,
+// so both can be updated with a single CAS; index does not depend on the address space layout like a pointer would
+static constexpr u32 COUNTER_BITS = 20;
+static constexpr i64 COUNTER_MASK = (i64(1) << COUNTER_BITS) - 1;
+static_assert(sizeof(System::m_fiber_pool) / sizeof(FiberDecl) < (u64(1) << (63 - COUNTER_BITS)), "Fiber index does not fit in Signal::state");
+
+LUMIX_FORCE_INLINE static i32 getCounter(i64 state) { return i32(state & COUNTER_MASK); }
+
+LUMIX_FORCE_INLINE static FiberDecl* getWaitor(i64 state) {
+	const u64 idx = u64(state) >> COUNTER_BITS;
+	return idx ? &g_system->m_fiber_pool[idx - 1] : nullptr;
+}
+
+LUMIX_FORCE_INLINE static i64 makeState(i32 counter, FiberDecl* waitor) {
+	return (waitor ? i64(waitor->idx + 1) << COUNTER_BITS : 0) | counter;
+}
 
 template <bool ZERO>
 LUMIX_FORCE_INLINE static bool trigger(Signal* signal)
 {
-	Waitor* waitor;
-	{
-		Lumix::MutexGuard lock(g_system->m_sync);
-
-		if constexpr (ZERO) {
-			signal->counter = 0;
+	i64 state;
+	for (;;) {
+		state = signal->state;
+		i64 new_state = 0;
+		if constexpr (!ZERO) {
+			ASSERT(getCounter(state) > 0);
+			if (getCounter(state) > 1) new_state = state - 1;
 		}
-		else {
-			--signal->counter;
-			ASSERT(signal->counter >= 0);
-			if (signal->counter > 0) return false;
+		if (compareAndExchange64(&signal->state, new_state, state)) {
+			if (new_state != 0) return false;
+			break;
 		}
-
-		waitor = signal->waitor;
-		signal->waitor = nullptr;
 	}
+
+	FiberDecl* waitor = getWaitor(state);
 	if (!waitor) return false;
 
-	bool wake_all = false;
-	{
-		Lumix::MutexGuard queue_lock(g_system->m_job_queue_sync);
-		while (waitor) {
-			Waitor* next = waitor->next;
-			const u8 worker = waitor->fiber->current_job.worker_index;
-			if (worker == ANY_WORKER) {
-				g_system->m_ready_fibers.push(waitor->fiber);
-				wake_all = true;
-			}
-			else {
-				WorkerTask* worker = g_system->m_workers[waitor->fiber->current_job.worker_index % g_system->m_workers.size()];
-				worker->m_ready_fibers.push(waitor->fiber);
-				if(!wake_all) worker->wakeup();
-			}
-			waitor = next;
-		}
-	}
-	if (wake_all) {
-		for (WorkerTask* worker : g_system->m_backup_workers) {
-			if (worker->m_is_enabled) worker->wakeup();
+	// waitors hold m_sync until their fiber is switched out, so they are safe to resume after we get it
+	g_system->m_sync.enter();
+	g_system->m_sync.exit();
+
+	Lumix::MutexGuard queue_lock(g_system->m_job_queue_sync);
+	while (waitor) {
+		FiberDecl* next = waitor->next_waitor;
+		const u8 worker_index = waitor->current_job.worker_index;
+		if (worker_index == ANY_WORKER) {
+			g_system->m_ready_fibers.push(waitor);
+			++g_system->m_global_work_count;
+			wakeupOneWorker();
 		}
-		for (WorkerTask* worker : g_system->m_workers) {
-			worker->wakeup();
+		else {
+			WorkerTask* worker = g_system->m_workers[worker_index % g_system->m_workers.size()];
+			worker->m_ready_fibers.push(waitor);
+			++worker->m_pinned_work_count;
+			wakeupWorker(worker);
 		}
+		waitor = next;
 	}
 	return true;
 }
@@ -181,6 +397,8 @@ void enableBackupWorker(bool enable)
 	for (WorkerTask* task : g_system->m_backup_workers) {
 		if (task->m_is_enabled != enable) {
 			task->m_is_enabled = enable;
+			// disabled backup worker sleeps on m_sync
+			if (enable) task->wakeup();
 			return;
 		}
 	}
@@ -200,8 +418,8 @@ void enableBackupWorker(bool enable)
 
 LUMIX_FORCE_INLINE static bool setRedEx(Signal* signal) {
 	ASSERT(signal);
-	ASSERT(signal->counter <= 1);
-	bool res = compareAndExchange(&signal->counter, 1, 0);
+	ASSERT(getCounter(signal->state) <= 1);
+	bool res = compareAndExchange64(&signal->state, 1, 0);
 	if (res) {
 		signal->generation = atomicIncrement(&g_generation);
 	}
@@ -214,7 +432,7 @@ void setRed(Signal* signal) {
 
 void setGreen(Signal* signal) {
 	ASSERT(signal);
-	ASSERT(signal->counter <= 1);
+	ASSERT(getCounter(signal->state) <= 1);
 	const u32 gen = signal->generation;
 	if (trigger<true>(signal)){
 		profiler::signalTriggered(gen);
@@ -237,34 +455,75 @@ void runEx(void* data, void(*task)(void*), Signal* on_finished, u8 worker_index)
 	job.dec_on_finish = on_finished;
 
 	if (on_finished) {
-		Lumix::MutexGuard guard(g_system->m_sync);
-		++on_finished->counter;
-		if (on_finished->counter == 1) {
-			on_finished->generation = atomicIncrement(&g_generation);
+		for (;;) {
+			const i64 state = on_finished->state;
+			ASSERT(getCounter(state) < COUNTER_MASK);
+			if (compareAndExchange64(&on_finished->state, state + 1, state)) {
+				if (getCounter(state) == 0) {
+					on_finished->generation = atomicIncrement(&g_generation);
+				}
+				break;
+			}
 		}
 	}
 
 	if (worker_index != ANY_WORKER) {
 		WorkerTask* worker = g_system->m_workers[worker_index % g_system->m_workers.size()];
-		{
-			Lumix::MutexGuard lock(g_system->m_job_queue_sync);
-			worker->m_job_queue.push(job);
-		}
-		worker->wakeup();
+		Lumix::MutexGuard lock(g_system->m_job_queue_sync);
+		worker->m_job_queue.push(job);
+		++worker->m_pinned_work_count;
+		wakeupWorker(worker);
 		return;
 	}
 
-	{
+	WorkerTask* worker = getWorker();
+	if (worker && !worker->m_is_backup && worker->m_work_queue.push(job)) {
+		// pairs with the barrier in sleep path of manage(), so either we see the sleeper or it sees the job
+		memoryBarrier();
+		if (g_system->m_sleeping_count == 0) return;
+		
 		Lumix::MutexGuard lock(g_system->m_job_queue_sync);
-		g_system->m_job_queue.push(job);
+		wakeupOneWorker();
+		return;
 	}
 
-	for (WorkerTask* worker : g_system->m_workers) {
-		worker->wakeup();
+	Lumix::MutexGuard lock(g_system->m_job_queue_sync);
+	g_system->m_job_queue.push(job);
+	++g_system->m_global_work_count;
+	wakeupOneWorker();
+}
+
+// call with m_job_queue_sync locked
+static bool popLocked(WorkerTask* worker, Job& job, FiberDecl*& fiber) {
+	if (worker->m_pinned_work_count > 0) {
+		if (!worker->m_ready_fibers.empty()) {
+			fiber = worker->m_ready_fibers.back();
+			worker->m_ready_fibers.pop();
+			--worker->m_pinned_work_count;
+			return true;
+		}
+		if (!worker->m_job_queue.empty()) {
+			job = worker->m_job_queue.back();
+			worker->m_job_queue.pop();
+			--worker->m_pinned_work_count;
+			return true;
+		}
 	}
-	for (WorkerTask* worker : g_system->m_backup_workers) {
-		if (worker->m_is_enabled) worker->wakeup();
+	if (g_system->m_global_work_count > 0) {
+		if (!g_system->m_ready_fibers.empty()) {
+			fiber = g_system->m_ready_fibers.back();
+			g_system->m_ready_fibers.pop();
+			--g_system->m_global_work_count;
+			return true;
+		}
+		if(!g_system->m_job_queue.empty()) {
+			job = g_system->m_job_queue.back();
+			g_system->m_job_queue.pop();
+			--g_system->m_global_work_count;
+			return true;
+		}
 	}
+	return false;
 }
 
 
@@ -292,32 +551,31 @@ void runEx(void* data, void(*task)(void*), Signal* on_finished, u8 worker_index)
 		FiberDecl* fiber = nullptr;
 		Job job;
 		while (!worker->m_finished) {
-			Lumix::MutexGuard lock(g_system->m_job_queue_sync);
-
-			if (!worker->m_ready_fibers.empty()) {
-				fiber = worker->m_ready_fibers.back();
-				worker->m_ready_fibers.pop();
-				break;
-			}
-			if (!worker->m_job_queue.empty()) {
-				job = worker->m_job_queue.back();
-				worker->m_job_queue.pop();
-				break;
-			}
-			if (!g_system->m_ready_fibers.empty()) {
-				fiber = g_system->m_ready_fibers.back();
-				g_system->m_ready_fibers.pop();
-				break;
+			if (worker->m_pinned_work_count > 0 || g_system->m_global_work_count > 0) {
+				Lumix::MutexGuard lock(g_system->m_job_queue_sync);
+				if (popLocked(worker, job, fiber)) break;
 			}
-			if(!g_system->m_job_queue.empty()) {
-				job = g_system->m_job_queue.back();
-				g_system->m_job_queue.pop();
-				break;
+			if (!worker->m_is_backup && worker->m_work_queue.pop(job)) break;
+			if (steal(worker, job)) break;
+
+			Lumix::MutexGuard lock(g_system->m_job_queue_sync);
+			if (popLocked(worker, job, fiber)) break;
+
+			worker->m_is_sleeping = true;
+			g_system->m_sleeping_workers.push(worker);
+			// full barrier, pairs with the one in runEx
+			atomicIncrement(&g_system->m_sleeping_count);
+			if (isAnyQueueStealable()) {
+				removeSleepingWorker(worker);
+				continue;
 			}
 
 			PROFILE_BLOCK("sleeping");
 			profiler::blockColor(0x30, 0x30, 0x30);
-			worker->sleep(g_system->m_job_queue_sync);
+			while (worker->m_is_sleeping && !worker->m_finished) {
+				worker->sleep(g_system->m_job_queue_sync);
+			}
+			removeSleepingWorker(worker);
 			
 			if (worker->m_is_backup) break;
 		}
@@ -345,6 +603,7 @@ void runEx(void* data, void(*task)(void*), Signal* on_finished, u8 worker_index)
 			this_fiber->current_job = job;
 			job.task(job.data);
             this_fiber->current_job.task = nullptr;
+			this_fiber->scratch.reset(0);
 			if (job.dec_on_finish) {
 				trigger<false>(job.dec_on_finish);
 			}
@@ -372,8 +631,10 @@ bool init(u8 workers_count, IAllocator& allocator)
 	}
 
 	int count = maximum(1, int(workers_count));
+	// workers access m_workers as soon as they start, it must not reallocate
+	g_system->m_workers.reserve(count);
 	for (int i = 0; i < count; ++i) {
-		WorkerTask* task = LUMIX_NEW(allocator, WorkerTask)(*g_system, i < 64 ? u64(1) << i : 0);
+		WorkerTask* task = LUMIX_NEW(allocator, WorkerTask)(*g_system, (u8)i);
 		if (task->create("Worker", false)) {
 			task->m_is_enabled = true;
 			g_system->m_workers.push(task);
@@ -400,6 +661,24 @@ IAllocator& getAllocator() {
 	return g_system->m_allocator;
 }
 
+IAllocator& getScratchAllocator() {
+	WorkerTask* worker = getWorker();
+	if (!worker) return g_system->m_allocator;
+	return worker->m_current_fiber->scratch;
+}
+
+ScratchScope::ScratchScope() {
+	WorkerTask* worker = getWorker();
+	m_fiber = worker ? worker->m_current_fiber : nullptr;
+	m_top = m_fiber ? m_fiber->scratch.m_top : 0;
+}
+
+ScratchScope::~ScratchScope() {
+	if (!m_fiber) return;
+	ASSERT(getWorker()->m_current_fiber == m_fiber);
+	m_fiber->scratch.reset(m_top);
+}
+
 void shutdown()
 {
 	IAllocator& allocator = g_system->m_allocator;
@@ -441,30 +720,27 @@ void shutdown()
 static void waitEx(Signal* signal, bool is_mutex)
 {
 	ASSERT(signal);
-	if (signal->counter == 0) return;
+	if (getCounter(signal->state) == 0) return;
 
-	g_system->m_sync.enter();
-	if (signal->counter == 0) {
-		g_system->m_sync.exit();
-		return;
-	}
-	
 	if (!getWorker()) {
-		while (signal->counter > 0) {
-			g_system->m_sync.exit();
+		while (getCounter(signal->state) > 0) {
 			os::sleep(1);
-			g_system->m_sync.enter();
 		}
-		g_system->m_sync.exit();
 		return;
 	}
 
+	g_system->m_sync.enter();
 	FiberDecl* this_fiber = getWorker()->m_current_fiber;
 
-	Waitor waitor;
-	waitor.fiber = this_fiber;
-	waitor.next = signal->waitor;
-	signal->waitor = &waitor;
+	for (;;) {
+		const i64 state = signal->state;
+		if (getCounter(state) == 0) {
+			g_system->m_sync.exit();
+			return;
+		}
+		this_fiber->next_waitor = getWaitor(state);
+		if (compareAndExchange64(&signal->state, makeState(getCounter(state), this_fiber), state)) break;
+	}
 
 	const profiler::FiberSwitchData& switch_data = profiler::beginFiberWait(signal->generation, is_mutex);
 	FiberDecl* new_fiber = g_system->m_free_fibers.back();
@@ -494,6 +770,11 @@ void exit(Mutex* mutex) {
 	setGreen(&mutex->signal);
 }
 
+bool isLocalQueueEmpty() {
+	WorkerTask* worker = getWorker();
+	return !worker || worker->m_work_queue.isEmpty();
+}
+
 void wait(Signal* handle) {
 	waitEx(handle, false);
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "lumix.h"
+#include "atomic.h"
 
 namespace Lumix {
 
@@ -9,11 +10,16 @@ namespace jobs {
 
 constexpr u8 ANY_WORKER = 0xff;
 
+struct FiberDecl;
 struct Mutex;
 struct Signal;
 
 LUMIX_ENGINE_API bool init(u8 workers_count, IAllocator& allocator);
 LUMIX_ENGINE_API IAllocator& getAllocator();
+// bump allocator of the current job, cheap temporaries which do not outlive the job,
+// memory is reclaimed at the end of the innermost ScratchScope or when the job finishes,
+// must not be used by other jobs; on threads which are not workers it's getAllocator()
+LUMIX_ENGINE_API IAllocator& getScratchAllocator();
 LUMIX_ENGINE_API void shutdown();
 LUMIX_ENGINE_API u8 getWorkersCount();
 
@@ -28,6 +34,8 @@ LUMIX_ENGINE_API void setGreen(Signal* signal);
 LUMIX_ENGINE_API void run(void* data, void(*task)(void*), Signal* on_finish);
 LUMIX_ENGINE_API void runEx(void* data, void (*task)(void*), Signal* on_finish, u8 worker_index);
 LUMIX_ENGINE_API void wait(Signal* signal);
+// true if current worker's own queue has no jobs, i.e. other workers stole them or there were none
+LUMIX_ENGINE_API bool isLocalQueueEmpty();
 
 template <typename F>
 void runLambda(F&& f, Signal* on_finish, u8 worker = ANY_WORKER) {
@@ -86,6 +94,18 @@ void forEach(i32 count, i32 step, const F& f)
 	});
 }
 
+// everything allocated from getScratchAllocator() during the lifetime of the scope is released at its end
+struct LUMIX_ENGINE_API ScratchScope {
+	ScratchScope();
+	~ScratchScope();
+	ScratchScope(const ScratchScope&) = delete;
+	void operator=(const ScratchScope&) = delete;
+
+private:
+	FiberDecl* m_fiber;
+	u32 m_top;
+};
+
 struct MutexGuard {
 	MutexGuard(Mutex& mutex) : mutex(mutex) { enter(&mutex); }
 	~MutexGuard() { exit(&mutex); }
@@ -94,10 +114,10 @@ struct MutexGuard {
 };
 
 struct Signal {
-	~Signal() { ASSERT(!waitor); ASSERT(!counter); }
+	~Signal() { ASSERT(!state); }
 
-	struct Waitor* waitor = nullptr;
-	volatile i32 counter = 0;
+	// counter and waitor list packed together, do not access this outside of job_system.cpp
+	volatile i64 state = 0;
 	i32 generation; // identify different red-green pairs on the same signal, used by profiler
 };
 
@@ -105,6 +125,100 @@ struct Mutex {
 	Signal signal; // do not access this outside of job_system.cpp
 };
 
+namespace detail {
+
+// Lazy binary splitting - task processes its range in chunks of `grain` items and before each chunk
+// it pushes the upper half of the remaining range as a new job, but only if its previous split was stolen
+template <typename Task>
+struct RangeSplitter {
+	struct Range {
+		RangeSplitter* splitter;
+		i32 from;
+		i32 to;
+	};
+
+	RangeSplitter(const Task& task, i32 grain) : task(task), grain(grain) {}
+
+	static void execute(void* data) {
+		const Range* range = (const Range*)data;
+		range->splitter->task(*range->splitter, range->from, range->to);
+	}
+
+	// shrinks [from, to) if it splits, returns end of the chunk the task should process next
+	i32 split(i32 from, i32& to) {
+		while (to - from >= 2 * grain && isLocalQueueEmpty()) {
+			const i32 idx = atomicIncrement(&ranges_count) - 1;
+			if (idx >= (i32)lengthOf(ranges)) break;
+
+			const i32 mid = from + (to - from) / 2;
+			ranges[idx] = {this, mid, to};
+			to = mid;
+			jobs::run(&ranges[idx], &execute, &signal);
+		}
+		return to - from > grain ? from + grain : to;
+	}
+
+	void run(i32 count) {
+		task(*this, 0, count);
+		wait(&signal);
+	}
+
+	const Task& task;
+	const i32 grain;
+	volatile i32 ranges_count = 0;
+	Range ranges[128];
+	Signal signal;
+};
+
+inline i32 computeGrain(i32 count, i32 min_grain) {
+	// enough chunks so late workers still have something to steal
+	const i32 grain = count / (getWorkersCount() * 32);
+	return grain > min_grain ? grain : (min_grain > 0 ? min_grain : 1);
+}
+
+} // namespace detail
+
+// calls f(from, to) on subranges of [0, count), ranges are split only when other workers are idle, 
+// so there is no need to pick a step, min_grain is the smallest range worth a job
+template <typename F>
+void parallelFor(i32 count, const F& f, i32 min_grain = 1) {
+	if (count <= 0) return;
+
+	auto task = [&f](auto& splitter, i32 from, i32 to) {
+		while (from < to) {
+			const i32 end = splitter.split(from, to);
+			f(from, end);
+			from = end;
+		}
+	};
+	detail::RangeSplitter<decltype(task)> splitter(task, detail::computeGrain(count, min_grain));
+	splitter.run(count);
+}
+
+// map(from, to, partial) accumulates [from, to) into partial, which starts as T{},
+// fold(result, partial) combines partials into result, it's never called concurrently
+template <typename T, typename Map, typename Fold>
+void parallelReduce(i32 count, T& result, const Map& map, const Fold& fold, i32 min_grain = 1) {
+	if (count <= 0) return;
+
+	// spinlock, folds are short and jobs::Mutex can not be used outside of workers
+	volatile i32 lock = 0;
+	auto task = [&](auto& splitter, i32 from, i32 to) {
+		T partial{};
+		while (from < to) {
+			const i32 end = splitter.split(from, to);
+			map(from, end, partial);
+			from = end;
+		}
+		while (!compareAndExchange(&lock, 1, 0)) {}
+		fold(result, static_cast<const T&>(partial));
+		memoryBarrier();
+		lock = 0;
+	};
+	detail::RangeSplitter<decltype(task)> splitter(task, detail::computeGrain(count, min_grain));
+	splitter.run(count);
+}
+
 } // namespace jobs
 
 } // namespace Lumix
\ No newline at end of file
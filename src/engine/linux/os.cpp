@@ -406,6 +406,49 @@ bool InputFile::seek(u64 pos) {
 }
 
 
+MappedFile::MappedFile()
+	: m_handle(nullptr)
+	, m_data(nullptr)
+	, m_size(0)
+{}
+
+
+MappedFile::~MappedFile() {
+	ASSERT(!m_data);
+}
+
+
+bool MappedFile::open(const char* path) {
+	ASSERT(!m_data);
+	const int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	// the mapping keeps its own reference to the file
+	void* mem = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mem == MAP_FAILED) return false;
+
+	m_data = (const u8*)mem;
+	m_size = st.st_size;
+	return true;
+}
+
+
+void MappedFile::close() {
+	if (m_data) {
+		munmap((void*)m_data, m_size);
+		m_data = nullptr;
+		m_size = 0;
+	}
+}
+
+
 u32 getCPUsCount() {
 	return sysconf(_SC_NPROCESSORS_ONLN);
 }
@@ -912,6 +955,10 @@ void memCommit(void* ptr, size_t size) {
 	// noop on linux
 }
 
+void memDecommit(void* ptr, size_t size) {
+	madvise(ptr, size, MADV_DONTNEED);
+}
+
 void memRelease(void* ptr, size_t size) {
 	munmap(ptr, size);
 }
@@ -723,7 +723,7 @@ static int LUA_loadUniverse(lua_State* L)
 	inst->path = path;
 	inst->L = L;
 	inst->lua_func = luaL_ref(L, LUA_REGISTRYINDEX);
-	fs.getContent(inst->path, makeDelegate<&Callback::invoke>(inst));
+	fs.getContent(inst->path, makeDelegate<&Callback::invoke>(inst), FileSystem::Priority::NORMAL);
 	return 0;
 }
 
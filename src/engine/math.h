@@ -374,6 +374,7 @@ constexpr float PI = 3.14159265f;
 constexpr float HALF_PI = 3.14159265f * 0.5f;
 constexpr float SQRT2 = 1.41421356237f;
 constexpr float SQRT3 = 1.73205080757f;
+constexpr float SQRT1_2 = 0.70710678118f;
 
 
 template <typename T> LUMIX_FORCE_INLINE void swap(T& a, T& b) {
@@ -467,6 +468,19 @@ template <typename T> bool isPowOfTwo(T n)
 	return (n) && !(n & (n - 1));
 }
 
+// index of the lowest set bit, n must not be 0
+LUMIX_FORCE_INLINE u32 countTrailingZeros(u64 n)
+{
+	ASSERT(n != 0);
+	#ifdef _WIN32
+		unsigned long res;
+		_BitScanForward64(&res, n);
+		return res;
+	#else
+		return __builtin_ctzll(n);
+	#endif
+}
+
 LUMIX_ENGINE_API float dot(const Vec4& op1, const Vec4& op2);
 LUMIX_ENGINE_API float dot(const Vec3& op1, const Vec3& op2);
 LUMIX_ENGINE_API float dot(const Vec2& op1, const Vec2& op2);
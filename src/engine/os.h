@@ -142,6 +142,25 @@ private:
 	void* m_handle;
     bool m_is_error;
 };
+
+
+// whole file mapped read-only to memory, data is valid until close
+struct LUMIX_ENGINE_API MappedFile {
+	MappedFile();
+	~MappedFile();
+
+	[[nodiscard]] bool open(const char* path);
+	void close();
+
+	const u8* data() const { return m_data; }
+	u64 size() const { return m_size; }
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	void* m_handle;
+	const u8* m_data;
+	u64 m_size;
+};
 	
 
 struct FileInfo {
@@ -164,6 +183,7 @@ LUMIX_ENGINE_API ThreadID getCurrentThreadID();
 
 LUMIX_ENGINE_API void* memReserve(size_t size);
 LUMIX_ENGINE_API void memCommit(void* ptr, size_t size);
+LUMIX_ENGINE_API void memDecommit(void* ptr, size_t size); // memory stays reserved, call memCommit before using it again
 LUMIX_ENGINE_API void memRelease(void* ptr, size_t size); // size must be full size used in reserve
 LUMIX_ENGINE_API u32 getMemPageSize();
 LUMIX_ENGINE_API u32 getMemPageAlignment();
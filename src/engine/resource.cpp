@@ -1,8 +1,11 @@
 #include "engine/resource.h"
+#include "engine/allocator.h"
 #include "engine/hash.h"
+#include "engine/job_system.h"
 #include "engine/log.h"
 #include "engine/lumix.h"
 #include "engine/path.h"
+#include "engine/profiler.h"
 #include "engine/resource_manager.h"
 #include "engine/stream.h"
 #include "engine/string.h"
@@ -35,7 +38,33 @@ Resource::Resource(const Path& path, ResourceManager& resource_manager, IAllocat
 }
 
 
-Resource::~Resource() = default;
+// decompresses and, if the resource allows it, loads the resource on a job worker
+struct Resource::LoadJob {
+	LoadJob(Resource& resource, IAllocator& allocator)
+		: resource(resource)
+		, src_copy(allocator)
+		, data(allocator)
+	{}
+
+	Resource& resource;
+	// points either to the file system's persistent content or to src_copy
+	Span<const u8> src;
+	OutputMemoryStream src_copy;
+	OutputMemoryStream data;
+	// what is passed to load(), src or decompressed data
+	Span<const u8> content;
+	u64 decompressed_size;
+	bool compressed;
+	bool success = false;
+	bool loaded = false;
+	FileSystem::AsyncHandle handle = FileSystem::AsyncHandle::invalid();
+	jobs::Signal signal;
+};
+
+
+Resource::~Resource() {
+	ASSERT(!m_load_job);
+}
 
 
 void Resource::refresh() {
@@ -126,14 +155,9 @@ void Resource::fileLoaded(u64 size, const u8* mem, bool success) {
 		logError("Unsupported resource file version, please delete .lumix directory");
 		++m_failed_dep_count;
 	}
-	else if (header->flags & CompiledResourceHeader::COMPRESSED) {
-		OutputMemoryStream tmp(m_resource_manager.m_allocator);
-		tmp.resize(header->decompressed_size);
-		const i32 res = LZ4_decompress_safe((const char*)mem + sizeof(*header), (char*)tmp.getMutableData(), i32(size - sizeof(*header)), (i32)tmp.size());
-		if (res != header->decompressed_size || !load(header->decompressed_size, tmp.data())) {
-			++m_failed_dep_count;
-		}
-		m_size = header->decompressed_size;
+	else if ((header->flags & CompiledResourceHeader::COMPRESSED) || isLoadThreadSafe()) {
+		startLoadJob(size, mem);
+		return;
 	}
 	else {
 		if (!load(size - sizeof(*header), mem + sizeof(*header))) {
@@ -149,8 +173,91 @@ void Resource::fileLoaded(u64 size, const u8* mem, bool success) {
 }
 
 
+void Resource::startLoadJob(u64 size, const u8* mem)
+{
+	const CompiledResourceHeader* header = (const CompiledResourceHeader*)mem;
+	IAllocator& allocator = m_resource_manager.m_allocator;
+	ASSERT(!m_load_job);
+	m_load_job = LUMIX_NEW(allocator, LoadJob)(*this, allocator);
+	m_load_job->compressed = header->flags & CompiledResourceHeader::COMPRESSED;
+	m_load_job->decompressed_size = header->decompressed_size;
+
+	FileSystem& fs = m_resource_manager.getOwner().getFileSystem();
+	const Span<const u8> payload(mem + sizeof(*header), u32(size - sizeof(*header)));
+	if (fs.hasPersistentContent()) {
+		// e.g. mapped pak, no need to copy
+		m_load_job->src = payload;
+	}
+	else {
+		// `mem` is valid only during the callback
+		m_load_job->src_copy.write(payload.begin(), payload.length());
+		m_load_job->src = Span(m_load_job->src_copy.data(), (u32)m_load_job->src_copy.size());
+	}
+
+	m_load_job->handle = fs.beginWork(makeDelegate<&Resource::loadJobFinished>(this));
+	m_async_op = m_load_job->handle;
+	jobs::run(m_load_job, &Resource::runLoadJob, &m_load_job->signal);
+}
+
+
+void Resource::runLoadJob(void* data)
+{
+	PROFILE_FUNCTION();
+	LoadJob* job = (LoadJob*)data;
+	Resource& resource = job->resource;
+	if (job->compressed) {
+		job->data.resize(job->decompressed_size);
+		const i32 res = LZ4_decompress_safe((const char*)job->src.begin(), (char*)job->data.getMutableData(), (i32)job->src.length(), (i32)job->data.size());
+		job->success = res == job->decompressed_size;
+		job->src_copy.free();
+		job->src = {};
+		job->content = Span(job->data.data(), (u32)job->data.size());
+	}
+	else {
+		job->content = job->src;
+		job->success = true;
+	}
+
+	if (job->success && resource.isLoadThreadSafe()) {
+		job->success = resource.load(job->content.length(), job->content.begin());
+		job->loaded = true;
+	}
+
+	resource.m_resource_manager.getOwner().getFileSystem().finishWork(job->handle);
+}
+
+
+void Resource::loadJobFinished(u64 size, const u8* mem, bool success)
+{
+	LoadJob* job = m_load_job;
+	ASSERT(job);
+	// finishWork is called from inside the job, make sure it has returned
+	jobs::wait(&job->signal);
+	m_load_job = nullptr;
+	m_async_op = FileSystem::AsyncHandle::invalid();
+	ASSERT(m_desired_state == State::READY);
+
+	bool loaded = job->success;
+	if (loaded && !job->loaded) loaded = load(job->content.length(), job->content.begin());
+	if (!loaded) ++m_failed_dep_count;
+	m_size = job->decompressed_size;
+	LUMIX_DELETE(m_resource_manager.m_allocator, job);
+
+	ASSERT(m_empty_dep_count > 0);
+	--m_empty_dep_count;
+	checkState();
+}
+
+
 void Resource::doUnload()
 {
+	if (m_load_job) {
+		// load() might be running on a worker
+		jobs::wait(&m_load_job->signal);
+		LUMIX_DELETE(m_resource_manager.m_allocator, m_load_job);
+		m_load_job = nullptr;
+	}
+
 	if (m_async_op.isValid())
 	{
 		FileSystem& fs = m_resource_manager.getOwner().getFileSystem();
@@ -196,12 +303,14 @@ void Resource::doLoad()
 
 	const FilePathHash hash = m_path.getHash();
 	if (startsWith(m_path.c_str(), ".lumix/asset_tiles/")) {
-		m_async_op = fs.getContent(m_path, cb);
+		// editor thumbnails must not delay scene content
+		m_async_op = fs.getContent(m_path, cb, FileSystem::Priority::LOW);
 	}
 	else {	
 		const StaticString<LUMIX_MAX_PATH> res_path(".lumix/resources/", hash.getHashValue(), ".res");
-		m_async_op = fs.getContent(Path(res_path), cb);
+		m_async_op = fs.getContent(Path(res_path), cb, m_priority);
 	}
+	m_priority = FileSystem::Priority::NORMAL;
 }
 
 
@@ -79,6 +79,8 @@ protected:
 	virtual void onBeforeReady() {}
 	virtual void unload() = 0;
 	virtual bool load(u64 size, const u8* mem) = 0;
+	// return true if load() touches only the resource itself, so it can run on a job worker
+	virtual bool isLoadThreadSafe() const { return false; }
 
 	void onCreated(State state);
 	void doUnload();
@@ -92,8 +94,13 @@ protected:
 	ResourceManager& m_resource_manager;
 
 private:
+	struct LoadJob;
+
 	void doLoad();
 	void fileLoaded(u64 size, const u8* mem, bool success);
+	void startLoadJob(u64 size, const u8* mem);
+	static void runLoadJob(void* data);
+	void loadJobFinished(u64 size, const u8* mem, bool success);
 	void onStateChanged(State old_state, State new_state, Resource&);
 
 	Resource(const Resource&) = delete;
@@ -106,6 +113,9 @@ private:
 	u16 m_failed_dep_count;
 	State m_current_state;
 	FileSystem::AsyncHandle m_async_op;
+	// priority of the next read, set by whoever asked for the resource first
+	FileSystem::Priority m_priority = FileSystem::Priority::NORMAL;
+	LoadJob* m_load_job = nullptr;
 	bool m_hooked = false;
 }; // struct Resource
 
@@ -40,7 +40,7 @@ Resource* ResourceManager::get(const Path& path)
 	return nullptr;
 }
 
-Resource* ResourceManager::load(const Path& path)
+Resource* ResourceManager::load(const Path& path, FileSystem::Priority priority)
 {
 	if (path.isEmpty()) return nullptr;
 	Resource* resource = get(path);
@@ -53,6 +53,7 @@ Resource* ResourceManager::load(const Path& path)
 
 	if(resource->isEmpty() && resource->m_desired_state == Resource::State::EMPTY)
 	{
+		resource->m_priority = priority;
 		if (m_owner->onBeforeLoad(*resource) == ResourceManagerHub::LoadHook::Action::DEFERRED)
 		{
 			ASSERT(!resource->m_hooked);
@@ -154,16 +155,16 @@ void ResourceManagerHub::init(FileSystem& fs)
 	m_file_system = &fs;
 }
 
-Resource* ResourceManagerHub::load(ResourceType type, const Path& path)
+Resource* ResourceManagerHub::load(ResourceType type, const Path& path, FileSystem::Priority priority)
 {
 	ResourceManager* manager = get(type);
 	if(!manager) return nullptr;
-	return load(*manager, path);
+	return load(*manager, path, priority);
 }
 	
-Resource* ResourceManagerHub::load(ResourceManager& manager, const Path& path)
+Resource* ResourceManagerHub::load(ResourceManager& manager, const Path& path, FileSystem::Priority priority)
 {
-	return manager.load(path);
+	return manager.load(path, priority);
 }
 
 ResourceManager* ResourceManagerHub::get(ResourceType type)
@@ -1,6 +1,7 @@
 #pragma once
 
 
+#include "engine/file_system.h"
 #include "engine/hash.h"
 #include "engine/hash_map.h"
 
@@ -30,7 +31,7 @@ struct LUMIX_ENGINE_API ResourceManager {
 	ResourceManagerHub& getOwner() const { return *m_owner; }
 
 protected:
-	Resource* load(const Path& path);
+	Resource* load(const Path& path, FileSystem::Priority priority);
 	virtual Resource* createResource(const Path& path) = 0;
 	virtual void destroyResource(Resource& resource) = 0;
 	Resource* get(const Path& path);
@@ -63,13 +64,14 @@ struct LUMIX_ENGINE_API ResourceManagerHub {
 	ResourceManager* get(ResourceType type);
 	const ResourceManagerTable& getAll() const { return m_resource_managers; }
 
+	// priority affects only resources which are not loading yet
 	template <typename R> 
-	R* load(const Path& path)
+	R* load(const Path& path, FileSystem::Priority priority = FileSystem::Priority::NORMAL)
 	{
-		return static_cast<R*>(load(R::TYPE, path));
+		return static_cast<R*>(load(R::TYPE, path, priority));
 	}
 
-	Resource* load(ResourceType type, const Path& path);
+	Resource* load(ResourceType type, const Path& path, FileSystem::Priority priority = FileSystem::Priority::NORMAL);
 
 	void setLoadHook(LoadHook* hook);
 	LoadHook::Action onBeforeLoad(Resource& resource) const;
@@ -83,7 +85,7 @@ struct LUMIX_ENGINE_API ResourceManagerHub {
 	FileSystem& getFileSystem() { return *m_file_system; }
 
 private:
-	Resource* load(ResourceManager& manager, const Path& path);
+	Resource* load(ResourceManager& manager, const Path& path, FileSystem::Priority priority);
 	IAllocator& m_allocator;
 	ResourceManagerTable m_resource_managers;
 	FileSystem* m_file_system;
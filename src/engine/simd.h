@@ -4,8 +4,17 @@
 #include "engine/lumix.h"
 
 
-#ifdef _WIN32
+#if defined _WIN32 || defined __SSE2__
+	#define LUMIX_SIMD_SSE
 	#include <xmmintrin.h>
+	#include <emmintrin.h>
+	#ifdef __AVX2__
+		#define LUMIX_SIMD_FLOAT8
+		#include <immintrin.h>
+	#endif
+#elif defined __aarch64__ && defined __ARM_NEON
+	#define LUMIX_SIMD_NEON
+	#include <arm_neon.h>
 #else
 	#include <math.h>
 	#include <string.h>
@@ -15,7 +24,7 @@ namespace Lumix
 {
 
 
-#ifdef _WIN32
+#ifdef LUMIX_SIMD_SSE
 	using float4 = __m128;
 
 
@@ -31,6 +40,14 @@ namespace Lumix
 	}
 
 
+	// converts 4 unaligned u16 to floats
+	LUMIX_FORCE_INLINE float4 f4LoadU16x4(const void* src)
+	{
+		const __m128i v = _mm_loadl_epi64((const __m128i*)src);
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+	}
+
+
 	LUMIX_FORCE_INLINE float4 f4Splat(float value)
 	{
 		return _mm_set_ps1(value);
@@ -79,6 +96,12 @@ namespace Lumix
 		return _mm_movemask_ps(a);
 	}
 
+	// selects `b` where `mask` is set, `a` elsewhere
+	LUMIX_FORCE_INLINE float4 f4Blend(float4 a, float4 b, float4 mask)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+	}
+
 
 	LUMIX_FORCE_INLINE float4 f4Add(float4 a, float4 b)
 	{
@@ -133,16 +156,153 @@ namespace Lumix
 		return _mm_max_ps(a, b);
 	}
 
-	LUMIX_FORCE_INLINE float4 operator +(float4 a, float4 b) {
-		return _mm_add_ps(a, b);
+	// gcc and clang have builtin operators for vector types
+	#if defined _MSC_VER && !defined __clang__
+		LUMIX_FORCE_INLINE float4 operator +(float4 a, float4 b) {
+			return _mm_add_ps(a, b);
+		}
+
+		LUMIX_FORCE_INLINE float4 operator -(float4 a, float4 b) {
+			return _mm_sub_ps(a, b);
+		}
+
+		LUMIX_FORCE_INLINE float4 operator *(float4 a, float4 b) {
+			return _mm_mul_ps(a, b);
+		}
+	#endif
+
+#elif defined LUMIX_SIMD_NEON
+	using float4 = float32x4_t;
+
+
+	LUMIX_FORCE_INLINE float4 f4LoadUnaligned(const void* src)
+	{
+		return vld1q_f32((const float*)src);
 	}
 
-	LUMIX_FORCE_INLINE float4 operator -(float4 a, float4 b) {
-		return _mm_sub_ps(a, b);
+
+	LUMIX_FORCE_INLINE float4 f4Load(const void* src)
+	{
+		return vld1q_f32((const float*)src);
 	}
 
-	LUMIX_FORCE_INLINE float4 operator *(float4 a, float4 b) {
-		return _mm_mul_ps(a, b);
+
+	// converts 4 unaligned u16 to floats
+	LUMIX_FORCE_INLINE float4 f4LoadU16x4(const void* src)
+	{
+		return vcvtq_f32_u32(vmovl_u16(vld1_u16((const uint16_t*)src)));
+	}
+
+
+	LUMIX_FORCE_INLINE float4 f4Splat(float value)
+	{
+		return vdupq_n_f32(value);
+	}
+
+	LUMIX_FORCE_INLINE float f4GetX(float4 v)
+	{
+		return vgetq_lane_f32(v, 0);
+	}
+
+	LUMIX_FORCE_INLINE float f4GetY(float4 v)
+	{
+		return vgetq_lane_f32(v, 1);
+	}
+
+	LUMIX_FORCE_INLINE float f4GetZ(float4 v)
+	{
+		return vgetq_lane_f32(v, 2);
+	}
+
+	LUMIX_FORCE_INLINE float f4GetW(float4 v)
+	{
+		return vgetq_lane_f32(v, 3);
+	}
+
+	LUMIX_FORCE_INLINE void f4Store(void* dest, float4 src)
+	{
+		vst1q_f32((float*)dest, src);
+	}
+
+	LUMIX_FORCE_INLINE float4 f4CmpGT(float4 a, float4 b)
+	{
+		return vreinterpretq_f32_u32(vcgtq_f32(a, b));
+	}
+
+	LUMIX_FORCE_INLINE float4 f4CmpLT(float4 a, float4 b)
+	{
+		return vreinterpretq_f32_u32(vcltq_f32(a, b));
+	}
+	
+	LUMIX_FORCE_INLINE int f4MoveMask(float4 a)
+	{
+		static const int32x4_t shift = {0, 1, 2, 3};
+		const uint32x4_t signs = vshrq_n_u32(vreinterpretq_u32_f32(a), 31);
+		return (int)vaddvq_u32(vshlq_u32(signs, shift));
+	}
+
+	// selects `b` where `mask` is set, `a` elsewhere
+	LUMIX_FORCE_INLINE float4 f4Blend(float4 a, float4 b, float4 mask)
+	{
+		return vbslq_f32(vreinterpretq_u32_f32(mask), b, a);
+	}
+
+
+	LUMIX_FORCE_INLINE float4 f4Add(float4 a, float4 b)
+	{
+		return vaddq_f32(a, b);
+	}
+
+
+	LUMIX_FORCE_INLINE float4 f4Sub(float4 a, float4 b)
+	{
+		return vsubq_f32(a, b);
+	}
+
+
+	LUMIX_FORCE_INLINE float4 f4Mul(float4 a, float4 b)
+	{
+		return vmulq_f32(a, b);
+	}
+
+
+	LUMIX_FORCE_INLINE float4 f4Div(float4 a, float4 b)
+	{
+		return vdivq_f32(a, b);
+	}
+
+
+	LUMIX_FORCE_INLINE float4 f4Rcp(float4 a)
+	{
+		// estimate + one Newton-Raphson step, to match precision of _mm_rcp_ps
+		const float4 e = vrecpeq_f32(a);
+		return vmulq_f32(vrecpsq_f32(a, e), e);
+	}
+
+
+	LUMIX_FORCE_INLINE float4 f4Sqrt(float4 a)
+	{
+		return vsqrtq_f32(a);
+	}
+
+
+	LUMIX_FORCE_INLINE float4 f4Rsqrt(float4 a)
+	{
+		// estimate + one Newton-Raphson step, to match precision of _mm_rsqrt_ps
+		const float4 e = vrsqrteq_f32(a);
+		return vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, e), e), e);
+	}
+
+
+	LUMIX_FORCE_INLINE float4 f4Min(float4 a, float4 b)
+	{
+		return vminq_f32(a, b);
+	}
+
+
+	LUMIX_FORCE_INLINE float4 f4Max(float4 a, float4 b)
+	{
+		return vmaxq_f32(a, b);
 	}
 
 #else 
@@ -164,6 +324,15 @@ namespace Lumix
 	}
 
 
+	// converts 4 unaligned u16 to floats
+	LUMIX_FORCE_INLINE float4 f4LoadU16x4(const void* src)
+	{
+		u16 tmp[4];
+		memcpy(tmp, src, sizeof(tmp));
+		return { (float)tmp[0], (float)tmp[1], (float)tmp[2], (float)tmp[3] };
+	}
+
+
 	LUMIX_FORCE_INLINE float4 f4Splat(float value)
 	{
 		return {value, value, value, value};
@@ -230,12 +399,28 @@ namespace Lumix
 			a.w < b.w ? lt : 0
 		};
 	}
+	// sign bits, like _mm_movemask_ps, so it works with NaN masks from f4Cmp*
 	LUMIX_FORCE_INLINE int f4MoveMask(float4 a)
 	{
-		return (a.w < 0 ? (1 << 3) : 0) | 
-			(a.z < 0 ? (1 << 2) : 0) | 
-			(a.y < 0 ? (1 << 1) : 0) | 
-			(a.x < 0 ? 1 : 0);
+		u32 u[4];
+		memcpy(u, &a, sizeof(u));
+		return ((u[3] >> 31) << 3) | 
+			((u[2] >> 31) << 2) | 
+			((u[1] >> 31) << 1) | 
+			(u[0] >> 31);
+	}
+
+	// selects `b` where `mask` is set, `a` elsewhere
+	LUMIX_FORCE_INLINE float4 f4Blend(float4 a, float4 b, float4 mask)
+	{
+		u32 m[4];
+		memcpy(m, &mask, sizeof(m));
+		return {
+			m[0] ? b.x : a.x,
+			m[1] ? b.y : a.y,
+			m[2] ? b.z : a.z,
+			m[3] ? b.w : a.w
+		};
 	}
 
 
@@ -352,5 +537,116 @@ namespace Lumix
 #endif
 
 
+#ifdef LUMIX_SIMD_FLOAT8
+	using float8 = __m256;
+
+
+	LUMIX_FORCE_INLINE float8 f8LoadUnaligned(const void* src)
+	{
+		return _mm256_loadu_ps((const float*)(src));
+	}
+
+
+	LUMIX_FORCE_INLINE float8 f8Load(const void* src)
+	{
+		return _mm256_load_ps((const float*)(src));
+	}
+
+
+	LUMIX_FORCE_INLINE float8 f8Splat(float value)
+	{
+		return _mm256_set1_ps(value);
+	}
+
+	LUMIX_FORCE_INLINE void f8Store(void* dest, float8 src)
+	{
+		_mm256_store_ps((float*)dest, src);
+	}
+
+	LUMIX_FORCE_INLINE float8 f8CmpGT(float8 a, float8 b)
+	{
+		return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+	}
+
+	LUMIX_FORCE_INLINE float8 f8CmpLT(float8 a, float8 b)
+	{
+		return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+	}
+	
+	LUMIX_FORCE_INLINE int f8MoveMask(float8 a)
+	{
+		return _mm256_movemask_ps(a);
+	}
+
+
+	LUMIX_FORCE_INLINE float8 f8Add(float8 a, float8 b)
+	{
+		return _mm256_add_ps(a, b);
+	}
+
+
+	LUMIX_FORCE_INLINE float8 f8Sub(float8 a, float8 b)
+	{
+		return _mm256_sub_ps(a, b);
+	}
+
+
+	LUMIX_FORCE_INLINE float8 f8Mul(float8 a, float8 b)
+	{
+		return _mm256_mul_ps(a, b);
+	}
+
+
+	LUMIX_FORCE_INLINE float8 f8Div(float8 a, float8 b)
+	{
+		return _mm256_div_ps(a, b);
+	}
+
+
+	LUMIX_FORCE_INLINE float8 f8Rcp(float8 a)
+	{
+		return _mm256_rcp_ps(a);
+	}
+
+
+	LUMIX_FORCE_INLINE float8 f8Sqrt(float8 a)
+	{
+		return _mm256_sqrt_ps(a);
+	}
+
+
+	LUMIX_FORCE_INLINE float8 f8Rsqrt(float8 a)
+	{
+		return _mm256_rsqrt_ps(a);
+	}
+
+
+	LUMIX_FORCE_INLINE float8 f8Min(float8 a, float8 b)
+	{
+		return _mm256_min_ps(a, b);
+	}
+
+
+	LUMIX_FORCE_INLINE float8 f8Max(float8 a, float8 b)
+	{
+		return _mm256_max_ps(a, b);
+	}
+
+	#if defined _MSC_VER && !defined __clang__
+		LUMIX_FORCE_INLINE float8 operator +(float8 a, float8 b) {
+			return _mm256_add_ps(a, b);
+		}
+
+		LUMIX_FORCE_INLINE float8 operator -(float8 a, float8 b) {
+			return _mm256_sub_ps(a, b);
+		}
+
+		LUMIX_FORCE_INLINE float8 operator *(float8 a, float8 b) {
+			return _mm256_mul_ps(a, b);
+		}
+	#endif
+#endif
+
+
 
 } // namespace Lumix
\ No newline at end of file
@@ -1,10 +1,12 @@
 #include "universe.h"
 #include "engine/engine.h"
 #include "engine/hash.h"
+#include "engine/job_system.h"
 #include "engine/log.h"
 #include "engine/math.h"
 #include "engine/plugin.h"
 #include "engine/prefab.h"
+#include "engine/profiler.h"
 #include "engine/reflection.h"
 #include "engine/string.h"
 
@@ -48,10 +50,20 @@ Universe::Universe(Engine& engine, IAllocator& allocator)
 	, m_engine(engine)
 	, m_names(m_allocator)
 	, m_entities(m_allocator)
+	, m_component_masks(m_allocator)
 	, m_component_added(m_allocator)
 	, m_component_destroyed(m_allocator)
 	, m_entity_destroyed(m_allocator)
 	, m_entity_moved(m_allocator)
+	, m_entities_moved(m_allocator)
+	, m_moved_entities(m_allocator)
+	, m_moved_mask(m_allocator)
+	, m_sorted_entities(m_allocator)
+	, m_sorted_parents(m_allocator)
+	, m_subtree_sizes(m_allocator)
+	, m_sorted_indices(m_allocator)
+	, m_dirty_entities(m_allocator)
+	, m_dirty_transforms(m_allocator)
 	, m_entity_created(m_allocator)
 	, m_first_free_slot(-1)
 	, m_scenes(m_allocator)
@@ -116,10 +128,94 @@ const Quat& Universe::getRotation(EntityRef entity) const
 }
 
 
+void Universe::onEntityMoved(EntityRef entity)
+{
+	if (m_transform_batch_depth == 0) {
+		m_entity_moved.invoke(entity);
+		m_entities_moved.invoke(Span<const EntityRef>(&entity, 1));
+		return;
+	}
+
+	const u32 word = entity.index / 64;
+	const u64 bit = u64(1) << (entity.index % 64);
+	if (m_moved_mask.size() <= (i32)word) {
+		const u32 old_size = m_moved_mask.size();
+		m_moved_mask.resize(maximum(word + 1, m_entities.size() / 64 + 1));
+		memset(&m_moved_mask[old_size], 0, (m_moved_mask.size() - old_size) * sizeof(u64));
+	}
+	if (m_moved_mask[word] & bit) return;
+
+	m_moved_mask[word] |= bit;
+	m_moved_entities.push(entity);
+}
+
+
+void Universe::beginTransformBatch()
+{
+	++m_transform_batch_depth;
+}
+
+
+void Universe::endTransformBatch()
+{
+	ASSERT(m_transform_batch_depth > 0);
+	if (m_transform_batch_depth > 1) {
+		--m_transform_batch_depth;
+		return;
+	}
+
+	// entities destroyed during the batch are not reported
+	u32 count = 0;
+	for (EntityRef e : m_moved_entities) {
+		m_moved_mask[e.index / 64] &= ~(u64(1) << (e.index % 64));
+		if (m_entities[e.index].valid) m_moved_entities[count++] = e;
+	}
+	m_moved_entities.resize(count);
+
+	m_transform_batch_depth = 0;
+	if (count == 0) return;
+
+	// handlers can move entities or open another batch
+	Array<EntityRef> moved(m_allocator);
+	moved.swap(m_moved_entities);
+	m_entities_moved.invoke(moved);
+	for (EntityRef e : moved) m_entity_moved.invoke(e);
+	moved.clear();
+	// keep the capacity
+	if (m_moved_entities.empty()) moved.swap(m_moved_entities);
+}
+
+
+void Universe::setTransforms(Span<const EntityRef> entities, Span<const Transform> transforms)
+{
+	ASSERT(entities.length() == transforms.length());
+	beginTransformBatch();
+	for (u32 i = 0, c = entities.length(); i < c; ++i) {
+		m_transforms[entities[i].index] = transforms[i];
+		transformEntity(entities[i], true);
+	}
+	endTransformBatch();
+}
+
+
+void Universe::setTransforms(Span<const EntityRef> entities, Span<const RigidTransform> transforms)
+{
+	ASSERT(entities.length() == transforms.length());
+	beginTransformBatch();
+	for (u32 i = 0, c = entities.length(); i < c; ++i) {
+		Transform& tr = m_transforms[entities[i].index];
+		tr.pos = transforms[i].pos;
+		tr.rot = transforms[i].rot;
+		transformEntity(entities[i], true);
+	}
+	endTransformBatch();
+}
+
+
 void Universe::transformEntity(EntityRef entity, bool update_local)
 {
 	const int hierarchy_idx = m_entities[entity.index].hierarchy;
-	m_entity_moved.invoke(entity);
+	onEntityMoved(entity);
 	if (hierarchy_idx >= 0) {
 		Hierarchy& h = m_hierarchy[hierarchy_idx];
 		const Transform my_transform = getTransform(entity);
@@ -169,7 +265,7 @@ void Universe::setTransformKeepChildren(EntityRef entity, const Transform& trans
 	tmp = transform;
 	
 	int hierarchy_idx = m_entities[entity.index].hierarchy;
-	entityTransformed().invoke(entity);
+	onEntityMoved(entity);
 	if (hierarchy_idx >= 0)
 	{
 		Hierarchy& h = m_hierarchy[hierarchy_idx];
@@ -305,6 +401,7 @@ void Universe::emplaceEntity(EntityRef entity)
 	{
 		EntityData& data = m_entities.emplace();
 		Transform& tr = m_transforms.emplace();
+		m_component_masks.push(0);
 		data.valid = false;
 		data.prev = -1;
 		data.name = -1;
@@ -338,6 +435,7 @@ void Universe::emplaceEntity(EntityRef entity)
 	data.hierarchy = -1;
 	data.components = 0;
 	data.valid = true;
+	m_component_masks[entity.index] = 0;
 
 	m_entity_created.invoke(entity);
 }
@@ -361,6 +459,7 @@ EntityRef Universe::createEntity(const DVec3& position, const Quat& rotation)
 		entity.index = m_entities.size();
 		data = &m_entities.emplace();
 		tr = &m_transforms.emplace();
+		m_component_masks.push(0);
 	}
 	tr->pos = position;
 	tr->rot = rotation;
@@ -369,6 +468,7 @@ EntityRef Universe::createEntity(const DVec3& position, const Quat& rotation)
 	data->hierarchy = -1;
 	data->components = 0;
 	data->valid = true;
+	m_component_masks[entity.index] = 0;
 	m_entity_created.invoke(entity);
 
 	return entity;
@@ -379,6 +479,10 @@ void Universe::destroyEntity(EntityRef entity)
 {
 	EntityData& entity_data = m_entities[entity.index];
 	ASSERT(entity_data.valid);
+	if (entity.index < m_dirty_transforms.size() && m_dirty_transforms[entity.index]) {
+		m_dirty_transforms[entity.index] = 0;
+		m_dirty_entities.swapAndPopItem(entity);
+	}
 	for (EntityPtr first_child = getFirstChild(entity); first_child.isValid(); first_child = getFirstChild(entity))
 	{
 		setParent(INVALID_ENTITY, (EntityRef)first_child);
@@ -487,6 +591,10 @@ void Universe::setParent(EntityPtr new_parent, EntityRef child)
 		return;
 	}
 
+	// local transforms are computed from world transforms below, those must be up to date
+	updateWorldTransforms();
+	m_is_sorted_hierarchy_valid = false;
+
 	auto collectGarbage = [this](EntityRef entity) {
 		Hierarchy& h = m_hierarchy[m_entities[entity.index].hierarchy];
 		if (h.parent.isValid()) return;
@@ -616,6 +724,129 @@ void Universe::setLocalTransform(EntityRef entity, const Transform& transform)
 }
 
 
+void Universe::setLocalTransformDeferred(EntityRef entity, const Transform& transform)
+{
+	const i32 hierarchy_idx = m_entities[entity.index].hierarchy;
+	if (hierarchy_idx < 0) {
+		setTransform(entity, transform);
+		return;
+	}
+
+	Hierarchy& h = m_hierarchy[hierarchy_idx];
+	// local transform of a root is its world transform
+	if (h.parent.isValid()) {
+		h.local_transform = transform;
+	}
+	else {
+		m_transforms[entity.index] = transform;
+	}
+
+	if (m_dirty_transforms.size() < m_entities.size()) {
+		const u32 old_size = m_dirty_transforms.size();
+		m_dirty_transforms.resize(m_entities.size());
+		memset(&m_dirty_transforms[old_size], 0, m_entities.size() - old_size);
+	}
+	if (m_dirty_transforms[entity.index]) return;
+	m_dirty_transforms[entity.index] = 1;
+	m_dirty_entities.push(entity);
+}
+
+
+void Universe::rebuildSortedHierarchy()
+{
+	PROFILE_FUNCTION();
+	m_sorted_entities.clear();
+	m_sorted_parents.clear();
+	m_subtree_sizes.clear();
+	m_sorted_indices.resize(m_entities.size());
+
+	for (const Hierarchy& root : m_hierarchy) {
+		if (root.parent.isValid()) continue;
+
+		// depth-first, so each subtree is contiguous
+		EntityRef e = root.entity;
+		for (;;) {
+			const Hierarchy& h = m_hierarchy[m_entities[e.index].hierarchy];
+			m_sorted_indices[e.index] = m_sorted_entities.size();
+			m_sorted_entities.push(e);
+			m_sorted_parents.push(h.parent.isValid() ? h.parent.index : -1);
+			m_subtree_sizes.push(1);
+			if (h.first_child.isValid()) {
+				e = (EntityRef)h.first_child;
+				continue;
+			}
+			// go up until there's a sibling, closing finished subtrees
+			for (;;) {
+				const Hierarchy& cur = m_hierarchy[m_entities[e.index].hierarchy];
+				const u32 idx = m_sorted_indices[e.index];
+				m_subtree_sizes[idx] = m_sorted_entities.size() - idx;
+				if (e == root.entity) break;
+				if (cur.next_sibling.isValid()) {
+					e = (EntityRef)cur.next_sibling;
+					break;
+				}
+				e = (EntityRef)cur.parent;
+			}
+			if (e == root.entity) break;
+		}
+	}
+	m_is_sorted_hierarchy_valid = true;
+}
+
+
+void Universe::updateWorldTransforms()
+{
+	if (m_dirty_entities.empty()) return;
+
+	PROFILE_FUNCTION();
+	if (!m_is_sorted_hierarchy_valid) rebuildSortedHierarchy();
+
+	// entities created after the last deferred change
+	if (m_dirty_transforms.size() < m_entities.size()) {
+		const u32 old_size = m_dirty_transforms.size();
+		m_dirty_transforms.resize(m_entities.size());
+		memset(&m_dirty_transforms[old_size], 0, m_entities.size() - old_size);
+	}
+
+	// dirty entities without a dirty ancestor, their subtrees do not overlap
+	Array<u32> roots(m_allocator);
+	roots.reserve(m_dirty_entities.size());
+	for (EntityRef e : m_dirty_entities) {
+		EntityPtr parent = m_hierarchy[m_entities[e.index].hierarchy].parent;
+		while (parent.isValid() && !m_dirty_transforms[parent.index]) {
+			parent = m_hierarchy[m_entities[parent.index].hierarchy].parent;
+		}
+		if (!parent.isValid()) roots.push(m_sorted_indices[e.index]);
+	}
+
+	jobs::parallelFor(roots.size(), [&](i32 from, i32 to){
+		const EntityRef* LUMIX_RESTRICT entities = m_sorted_entities.begin();
+		const i32* LUMIX_RESTRICT parents = m_sorted_parents.begin();
+		for (i32 r = from; r < to; ++r) {
+			const u32 start = roots[r];
+			const u32 end = start + m_subtree_sizes[start];
+			// world transform of a root is set directly
+			const u32 first = parents[start] < 0 ? start + 1 : start;
+			for (u32 i = first; i < end; ++i) {
+				const EntityRef e = entities[i];
+				const Transform& local_tr = m_hierarchy[m_entities[e.index].hierarchy].local_transform;
+				m_transforms[e.index] = m_transforms[parents[i]] * local_tr;
+			}
+		}
+	}, 8);
+
+	for (EntityRef e : m_dirty_entities) m_dirty_transforms[e.index] = 0;
+	m_dirty_entities.clear();
+
+	beginTransformBatch();
+	for (u32 start : roots) {
+		const u32 end = start + m_subtree_sizes[start];
+		for (u32 i = start; i < end; ++i) onEntityMoved(m_sorted_entities[i]);
+	}
+	endTransformBatch();
+}
+
+
 Transform Universe::getLocalTransform(EntityRef entity) const
 {
 	int hierarchy_idx = m_entities[entity.index].hierarchy;
@@ -642,22 +873,39 @@ float Universe::getLocalScale(EntityRef entity) const
 
 void Universe::serialize(OutputMemoryStream& serializer)
 {
-	serializer.write((u32)m_entities.size());
+	const u32 count = m_entities.size();
+	serializer.write(count);
 
-	for (u32 i = 0, c = m_entities.size(); i < c; ++i) {
-		if (!m_entities[i].valid) continue;
-		const EntityRef e = {(i32)i};
-		serializer.write(e);
-		serializer.write(m_transforms[i]);
+	u32 valid_count = 0;
+	for (const EntityData& e : m_entities) {
+		if (e.valid) ++valid_count;
 	}
-	serializer.write(INVALID_ENTITY);
+	serializer.write(valid_count);
 
-	serializer.write((u32)m_names.size());
-	for (const EntityName& name : m_names) {
-		serializer.write(name.entity);
-		serializer.writeString(name.name);
+	// validity bitmap
+	for (u32 i = 0; i < count; i += 64) {
+		u64 bits = 0;
+		for (u32 j = i, end = minimum(i + 64, count); j < end; ++j) {
+			if (m_entities[j].valid) bits |= u64(1) << (j - i);
+		}
+		serializer.write(bits);
+	}
+
+	// transforms of valid entities, consecutive valid entities are written at once
+	for (u32 i = 0; i < count;) {
+		if (!m_entities[i].valid) {
+			++i;
+			continue;
+		}
+		u32 end = i + 1;
+		while (end < count && m_entities[end].valid) ++end;
+		serializer.write(&m_transforms[i], (end - i) * sizeof(m_transforms[0]));
+		i = end;
 	}
 
+	serializer.write((u32)m_names.size());
+	if (!m_names.empty()) serializer.write(m_names.begin(), m_names.byte_size());
+
 	serializer.write((u32)m_hierarchy.size());
 	if (!m_hierarchy.empty()) serializer.write(&m_hierarchy[0], m_hierarchy.byte_size());
 }
@@ -666,30 +914,68 @@ void Universe::setName(const char* name) {
 	copyString(m_name, name);
 }
 
-void Universe::deserialize(InputMemoryStream& serializer, EntityMap& entity_map)
+void Universe::deserialize(InputMemoryStream& serializer, EntityMap& entity_map, SerializedEngineVersion version)
 {
+	PROFILE_FUNCTION();
 	u32 to_reserve;
 	serializer.read(to_reserve);
 	entity_map.reserve(to_reserve);
 
-	for (EntityPtr e = serializer.read<EntityPtr>(); e.isValid(); e = serializer.read<EntityPtr>()) {
-		EntityRef orig = (EntityRef)e;
-		const EntityRef new_e = createEntity({0, 0, 0}, {0, 0, 0, 1});
-		entity_map.set(orig, new_e);
-		serializer.read(m_transforms[new_e.index]);
+	u32 count;
+	if (version > SerializedEngineVersion::CHUNKED) {
+		u32 valid_count;
+		serializer.read(valid_count);
+		const u8* valid_bits = (const u8*)serializer.skip((to_reserve + 63) / 64 * sizeof(u64));
+		const u8* transforms = (const u8*)serializer.skip(valid_count * sizeof(Transform));
+		m_entities.reserve(m_entities.size() + valid_count);
+		m_transforms.reserve(m_transforms.size() + valid_count);
+		m_component_masks.reserve(m_component_masks.size() + valid_count);
+
+		u32 transform_idx = 0;
+		for (u32 i = 0; i < to_reserve; i += 64) {
+			u64 bits;
+			memcpy(&bits, valid_bits + i / 8, sizeof(bits));
+			while (bits) {
+				const u32 bit = countTrailingZeros(bits);
+				bits &= bits - 1;
+				const EntityRef new_e = createEntity({0, 0, 0}, {0, 0, 0, 1});
+				entity_map.set(EntityRef{i32(i + bit)}, new_e);
+				memcpy(&m_transforms[new_e.index], transforms + transform_idx * sizeof(Transform), sizeof(Transform));
+				++transform_idx;
+			}
+		}
+		ASSERT(transform_idx == valid_count);
+
+		serializer.read(count);
+		const u32 old_names_count = m_names.size();
+		m_names.resize(old_names_count + count);
+		if (count > 0) serializer.read(&m_names[old_names_count], sizeof(m_names[0]) * count);
+		for (u32 i = old_names_count; i < old_names_count + count; ++i) {
+			EntityName& name = m_names[i];
+			name.entity = entity_map.get(name.entity);
+			m_entities[name.entity.index].name = i;
+		}
 	}
+	else {
+		for (EntityPtr e = serializer.read<EntityPtr>(); e.isValid(); e = serializer.read<EntityPtr>()) {
+			EntityRef orig = (EntityRef)e;
+			const EntityRef new_e = createEntity({0, 0, 0}, {0, 0, 0, 1});
+			entity_map.set(orig, new_e);
+			serializer.read(m_transforms[new_e.index]);
+		}
 
-	u32 count;
-	serializer.read(count);
-	for (u32 i = 0; i < count; ++i) {
-		EntityName& name = m_names.emplace();
-		serializer.read(name.entity);
-		name.entity = entity_map.get(name.entity);
-		copyString(name.name, serializer.readString());
-		m_entities[name.entity.index].name = m_names.size() - 1;
+		serializer.read(count);
+		for (u32 i = 0; i < count; ++i) {
+			EntityName& name = m_names.emplace();
+			serializer.read(name.entity);
+			name.entity = entity_map.get(name.entity);
+			copyString(name.name, serializer.readString());
+			m_entities[name.entity.index].name = m_names.size() - 1;
+		}
 	}
 
 	serializer.read(count);
+	m_is_sorted_hierarchy_valid = false;
 	const u32 old_count = m_hierarchy.size();
 	m_hierarchy.resize(count + old_count);
 	if (count > 0) {
@@ -778,6 +1064,7 @@ void Universe::onComponentDestroyed(EntityRef entity, ComponentType component_ty
 	mask &= ~((u64)1 << component_type.index);
 	ASSERT(old_mask != mask);
 	m_entities[entity.index].components = mask;
+	m_component_masks[entity.index] = mask;
 	m_component_destroyed.invoke(ComponentUID(entity, component_type, scene));
 }
 
@@ -802,6 +1089,7 @@ void Universe::onComponentCreated(EntityRef entity, ComponentType component_type
 {
 	ComponentUID cmp(entity, component_type, scene);
 	m_entities[entity.index].components |= (u64)1 << component_type.index;
+	m_component_masks[entity.index] = m_entities[entity.index].components;
 	m_component_added.invoke(cmp);
 }
 
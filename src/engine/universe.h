@@ -3,6 +3,7 @@
 
 #include "engine/array.h"
 #include "engine/delegate_list.h"
+#include "engine/job_system.h"
 #include "engine/lumix.h"
 #include "engine/math.h"
 
@@ -11,6 +12,7 @@ namespace Lumix {
 
 struct ComponentUID;
 struct IScene;
+enum class SerializedEngineVersion : u32;
 
 enum class UniverseSerializedVersion : u32
 {
@@ -59,6 +61,45 @@ struct LUMIX_ENGINE_API Universe {
 		bool valid;
 	};
 
+	// entities which have all components in mask, e.g. universe.query(mask).forEach([](EntityRef e){ ... });
+	struct Query {
+		Query& with(ComponentType type) { mask |= u64(1) << type.index; return *this; }
+		// f(EntityRef), in order of entity index
+		template <typename F> void forEach(const F& f) const;
+		// f(EntityRef) is called from multiple jobs at once, in no particular order
+		template <typename F> void forEachParallel(const F& f) const;
+
+		const Universe& universe;
+		u64 mask;
+
+	private:
+		enum { CHUNK_SIZE = 64, MIN_PARALLEL_CHUNKS = 16 };
+
+		// bit i is set if entity `from + i` matches, loop is branchless so it vectorizes
+		u64 matchChunk(u32 from, u32 to) const {
+			const u64* LUMIX_RESTRICT masks = universe.m_component_masks.begin();
+			u64 res = 0;
+			for (u32 i = from; i < to; ++i) {
+				res |= u64((masks[i] & mask) == mask) << (i - from);
+			}
+			return res;
+		}
+
+		template <typename F> void forEachInChunks(u32 from_chunk, u32 to_chunk, const F& f) const {
+			const u32 entities_count = universe.m_component_masks.size();
+			for (u32 chunk = from_chunk; chunk < to_chunk; ++chunk) {
+				const u32 from = chunk * CHUNK_SIZE;
+				const u32 to = minimum(from + CHUNK_SIZE, entities_count);
+				u64 matches = matchChunk(from, to);
+				while (matches) {
+					const u32 bit = countTrailingZeros(matches);
+					matches &= matches - 1;
+					f(EntityRef{i32(from + bit)});
+				}
+			}
+		}
+	};
+
 	explicit Universe(struct Engine& engine, IAllocator& allocator);
 	~Universe();
 
@@ -72,6 +113,7 @@ struct LUMIX_ENGINE_API Universe {
 	void onComponentCreated(EntityRef entity, ComponentType component_type, IScene* scene);
 	void onComponentDestroyed(EntityRef entity, ComponentType component_type, IScene* scene);
     u64 getComponentsMask(EntityRef entity) const;
+	Query query(u64 components_mask) const { ASSERT(components_mask != 0); return {*this, components_mask}; }
     bool hasComponent(EntityRef entity, ComponentType component_type) const;
 	ComponentUID getComponent(EntityRef entity, ComponentType type) const;
 	ComponentUID getFirstComponent(EntityRef entity) const;
@@ -95,12 +137,24 @@ struct LUMIX_ENGINE_API Universe {
 	void setLocalPosition(EntityRef entity, const DVec3& pos);
 	void setLocalRotation(EntityRef entity, const Quat& rot);
 	void setLocalTransform(EntityRef entity, const Transform& transform);
+	// does not update world transforms of the entity and its descendants until updateWorldTransforms,
+	// meant for many changes per frame, e.g. animated attachments
+	void setLocalTransformDeferred(EntityRef entity, const Transform& transform);
+	// propagates deferred local transforms to the changed subtrees, subtrees in parallel;
+	// called by the engine once per frame
+	void updateWorldTransforms();
 
 	Matrix getRelativeMatrix(EntityRef entity, const DVec3& base_pos) const;
 	void setTransform(EntityRef entity, const RigidTransform& transform);
 	void setTransform(EntityRef entity, const Transform& transform);
 	void setTransformKeepChildren(EntityRef entity, const Transform& transform);
 	void setTransform(EntityRef entity, const DVec3& pos, const Quat& rot, float scale);
+	void setTransforms(Span<const EntityRef> entities, Span<const Transform> transforms);
+	void setTransforms(Span<const EntityRef> entities, Span<const RigidTransform> transforms);
+	// transforms are still updated immediately, but notifications are deferred and deduplicated
+	// until the outermost endTransformBatch, which reports all moved entities at once
+	void beginTransformBatch();
+	void endTransformBatch();
 	const Transform& getTransform(EntityRef entity) const;
 	void setRotation(EntityRef entity, float x, float y, float z, float w);
 	void setRotation(EntityRef entity, const Quat& rot);
@@ -114,12 +168,14 @@ struct LUMIX_ENGINE_API Universe {
 
 	DelegateList<void(EntityRef)>& entityCreated() { return m_entity_created; }
 	DelegateList<void(EntityRef)>& entityTransformed() { return m_entity_moved; }
+	// invoked for each change outside of transform batches too, prefer this to entityTransformed
+	DelegateList<void(Span<const EntityRef>)>& entitiesTransformed() { return m_entities_moved; }
 	DelegateList<void(EntityRef)>& entityDestroyed() { return m_entity_destroyed; }
 	DelegateList<void(const ComponentUID&)>& componentDestroyed() { return m_component_destroyed; }
 	DelegateList<void(const ComponentUID&)>& componentAdded() { return m_component_added; }
 
 	void serialize(struct OutputMemoryStream& serializer);
-	void deserialize(struct InputMemoryStream& serializer, EntityMap& entity_map);
+	void deserialize(struct InputMemoryStream& serializer, EntityMap& entity_map, SerializedEngineVersion version);
 
 	IScene* getScene(ComponentType type) const;
 	IScene* getScene(const char* name) const;
@@ -128,6 +184,8 @@ struct LUMIX_ENGINE_API Universe {
 
 private:
 	void transformEntity(EntityRef entity, bool update_local);
+	void onEntityMoved(EntityRef entity);
+	void rebuildSortedHierarchy();
 	void updateGlobalTransform(EntityRef entity);
 
 	struct Hierarchy {
@@ -156,10 +214,26 @@ private:
 	Array<UniquePtr<IScene>> m_scenes;
 	Array<Transform> m_transforms;
 	Array<EntityData> m_entities;
+	// copy of EntityData::components, 0 for invalid entities, contiguous so queries can scan it fast
+	Array<u64> m_component_masks;
 	Array<Hierarchy> m_hierarchy;
 	Array<EntityName> m_names;
 	DelegateList<void(EntityRef)> m_entity_created;
 	DelegateList<void(EntityRef)> m_entity_moved;
+	DelegateList<void(Span<const EntityRef>)> m_entities_moved;
+	u32 m_transform_batch_depth = 0;
+	// entities moved during the current transform batch
+	Array<EntityRef> m_moved_entities;
+	Array<u64> m_moved_mask;
+	// m_hierarchy in depth-first order, parents before children, each subtree is contiguous
+	Array<EntityRef> m_sorted_entities;
+	Array<i32> m_sorted_parents; // entity index
+	Array<u32> m_subtree_sizes; // including the root of the subtree
+	Array<u32> m_sorted_indices; // indexed by entity
+	bool m_is_sorted_hierarchy_valid = false;
+	// entities changed by setLocalTransformDeferred
+	Array<EntityRef> m_dirty_entities;
+	Array<u8> m_dirty_transforms; // indexed by entity
 	DelegateList<void(EntityRef)> m_entity_destroyed;
 	DelegateList<void(const ComponentUID&)> m_component_destroyed;
 	DelegateList<void(const ComponentUID&)> m_component_added;
@@ -167,6 +241,20 @@ private:
 	char m_name[64];
 };
 
+template <typename F>
+void Universe::Query::forEach(const F& f) const {
+	const u32 chunks_count = (universe.m_component_masks.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	forEachInChunks(0, chunks_count, f);
+}
+
+template <typename F>
+void Universe::Query::forEachParallel(const F& f) const {
+	const u32 chunks_count = (universe.m_component_masks.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	jobs::parallelFor(chunks_count, [&](i32 from, i32 to){
+		forEachInChunks(from, to, f);
+	}, MIN_PARALLEL_CHUNKS);
+}
+
 struct LUMIX_ENGINE_API ComponentUID final {
 	ComponentUID() {
 		scene = nullptr;
@@ -187,6 +187,62 @@ bool InputFile::seek(u64 pos)
 }
 
 
+MappedFile::MappedFile()
+	: m_handle(nullptr)
+	, m_data(nullptr)
+	, m_size(0)
+{}
+
+
+MappedFile::~MappedFile()
+{
+	ASSERT(!m_data);
+}
+
+
+bool MappedFile::open(const char* path)
+{
+	ASSERT(!m_data);
+	const HANDLE file = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (INVALID_HANDLE_VALUE == file) return false;
+
+	LARGE_INTEGER size;
+	if (!::GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		::CloseHandle(file);
+		return false;
+	}
+
+	// the mapping keeps its own reference to the file
+	const HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	::CloseHandle(file);
+	if (!mapping) return false;
+
+	void* mem = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!mem) {
+		::CloseHandle(mapping);
+		return false;
+	}
+
+	m_handle = mapping;
+	m_data = (const u8*)mem;
+	m_size = size.QuadPart;
+	return true;
+}
+
+
+void MappedFile::close()
+{
+	if (m_data)
+	{
+		::UnmapViewOfFile(m_data);
+		::CloseHandle((HANDLE)m_handle);
+		m_handle = nullptr;
+		m_data = nullptr;
+		m_size = 0;
+	}
+}
+
+
 static void fromWChar(Span<char> out, const WCHAR* in)
 {
 	const WCHAR* c = in;
@@ -852,6 +908,10 @@ void memCommit(void* ptr, size_t size) {
 	VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE);
 }
 
+void memDecommit(void* ptr, size_t size) {
+	VirtualFree(ptr, size, MEM_DECOMMIT);
+}
+
 void memRelease(void* ptr, size_t size) {
 	VirtualFree(ptr, 0, MEM_RELEASE);
 }
@@ -92,13 +92,13 @@ struct NavigationSceneImpl final : NavigationScene
 		, m_script_scene(nullptr)
 		, m_on_update(m_allocator)
 	{
-		m_universe.entityTransformed().bind<&NavigationSceneImpl::onEntityMoved>(this);
+		m_universe.entitiesTransformed().bind<&NavigationSceneImpl::onEntitiesMoved>(this);
 	}
 
 
 	~NavigationSceneImpl()
 	{
-		m_universe.entityTransformed().unbind<&NavigationSceneImpl::onEntityMoved>(this);
+		m_universe.entitiesTransformed().unbind<&NavigationSceneImpl::onEntitiesMoved>(this);
 	}
 
 
@@ -112,6 +112,13 @@ struct NavigationSceneImpl final : NavigationScene
 	}
 
 
+	void onEntitiesMoved(Span<const EntityRef> entities)
+	{
+		if (m_agents.empty()) return;
+		for (EntityRef e : entities) onEntityMoved(e);
+	}
+
+
 	void onEntityMoved(EntityRef entity)
 	{
 		auto iter = m_agents.find(entity);
@@ -698,7 +705,7 @@ struct NavigationSceneImpl final : NavigationScene
 
 		StaticString<LUMIX_MAX_PATH> path("universes/navzones/", zone.zone.guid, ".nav");
 		FileSystem& fs = m_engine.getFileSystem();
-		return fs.getContent(Path(path), makeDelegate<&LoadCallback::fileLoaded>(lcb)).isValid();
+		return fs.getContent(Path(path), makeDelegate<&LoadCallback::fileLoaded>(lcb), FileSystem::Priority::NORMAL).isValid();
 	}
 
 	bool saveZone(EntityRef zone_entity) override {
@@ -39,7 +39,6 @@
 #include "engine/job_system.h"
 #include "engine/log.h"
 #include "engine/math.h"
-#include "engine/os.h"
 #include "engine/path.h"
 #include "engine/profiler.h"
 #include "engine/reflection.h"
@@ -254,17 +253,32 @@ struct PhysicsSceneImpl final : PhysicsScene
 {
 	struct CPUDispatcher : physx::PxCpuDispatcher
 	{
+		static void execute(void* data)
+		{
+			PxBaseTask* task = (PxBaseTask*)data;
+			PROFILE_BLOCK(task->getName());
+			profiler::blockColor(0x50, 0xff, 0x50);
+			task->run();
+			task->release();
+		}
+
 		void submitTask(PxBaseTask& task) override
 		{
-			jobs::runLambda([&task]() {
-					PROFILE_BLOCK(task.getName());
-					profiler::blockColor(0x50, 0xff, 0x50);
-					task.run();
-					task.release();
-				},
-				nullptr);
-		}
-		PxU32 getWorkerCount() const override { return os::getCPUsCount(); }
+			// the task itself is the job's data, nothing to allocate
+			if (pinned_workers == 0) {
+				jobs::run(&task, &execute, nullptr);
+				return;
+			}
+			// pinned tasks go to the last workers, away from the main thread's worker
+			const u32 idx = u32(atomicIncrement(&next_worker)) % pinned_workers;
+			jobs::runEx(&task, &execute, nullptr, u8(jobs::getWorkersCount() - 1 - idx));
+		}
+
+		// PhysX splits its work according to this, so it must match workers which run the tasks
+		PxU32 getWorkerCount() const override { return pinned_workers ? pinned_workers : jobs::getWorkersCount(); }
+
+		u32 pinned_workers = 0;
+		volatile i32 next_worker = 0;
 	};
 
 
@@ -375,6 +389,10 @@ struct PhysicsSceneImpl final : PhysicsScene
 		EntityPtr next_with_mesh = INVALID_ENTITY;
 		DynamicType dynamic_type = DynamicType::STATIC;
 		bool is_trigger = false;
+		// pose is being written from physx to universe, so it must not be pushed back to physx
+		bool is_write_back = false;
+		// moved outside of physics, its interpolation entry is dropped by removeTeleported
+		bool is_teleported = false;
 	};
 
 
@@ -421,6 +439,7 @@ struct PhysicsSceneImpl final : PhysicsScene
 
 	~PhysicsSceneImpl()
 	{
+		if (m_is_simulating) m_scene->fetchResults(true);
 		m_vehicle_batch_query->release();
 		m_vehicle_frictions->release();
 		m_controller_manager->release();
@@ -435,6 +454,10 @@ struct PhysicsSceneImpl final : PhysicsScene
 
 	void clear() override
 	{
+		if (m_is_simulating) {
+			m_scene->fetchResults(true);
+			m_is_simulating = false;
+		}
 		for (auto& controller : m_controllers)
 		{
 			controller.controller->release();
@@ -472,7 +495,8 @@ struct PhysicsSceneImpl final : PhysicsScene
 		m_joints.clear();
 
 		m_actors.clear();
-		m_dynamic_actors.clear();
+		m_interpolated.clear();
+		m_teleported.clear();
 
 		m_terrains.clear();
 	}
@@ -1350,10 +1374,17 @@ struct PhysicsSceneImpl final : PhysicsScene
 
 	void destroyRigidActor(EntityRef entity)
 	{
+		for (u32 i = 0, c = m_interpolated.size(); i < c; ++i) {
+			if (m_interpolated[i].entity != entity) continue;
+			// leave the entity at its latest simulated pose, unless it was moved since
+			const RigidTransform tr = m_interpolated[i].cur;
+			m_interpolated.swapAndPop(i);
+			if (!m_actors[entity].is_teleported) writeBack(Span(&entity, 1), Span(&tr, 1));
+			break;
+		}
 		RigidActor& actor = m_actors[entity];
 		actor.setPhysxActor(nullptr);
 		m_actors.erase(entity);
-		m_dynamic_actors.eraseItem(entity);
 		m_universe.onComponentDestroyed(entity, RIGID_ACTOR_TYPE, this);
 		if (m_is_game_running)
 		{
@@ -1690,18 +1721,152 @@ struct PhysicsSceneImpl final : PhysicsScene
 	}
 
 
+	// only actors moved by the last simulation, sleeping actors are not reported
+	void getActiveDynamicActors(Array<EntityRef>& entities, Array<RigidTransform>& transforms)
+	{
+		PxU32 active_count;
+		PxActor** active_actors = m_scene->getActiveActors(active_count);
+
+		entities.reserve(active_count);
+		transforms.reserve(active_count);
+		for (PxU32 i = 0; i < active_count; ++i) {
+			PxRigidActor* physx_actor = active_actors[i]->is<PxRigidActor>();
+			if (!physx_actor) continue;
+
+			// vehicles and other actors can be active too
+			const EntityRef entity = {(i32)(intptr_t)physx_actor->userData};
+			auto iter = m_actors.find(entity);
+			if (!iter.isValid()) continue;
+			const RigidActor& actor = iter.value();
+			if (actor.physx_actor != physx_actor || actor.dynamic_type != DynamicType::DYNAMIC) continue;
+
+			entities.push(entity);
+			transforms.push(fromPhysx(physx_actor->getGlobalPose()));
+		}
+	}
+
+
 	void updateDynamicActors()
 	{
 		PROFILE_FUNCTION();
-		for (EntityRef e : m_dynamic_actors)
-		{
-			RigidActor& actor = m_actors[e];
-			m_update_in_progress = &actor;
-			PxTransform trans = actor.physx_actor->getGlobalPose();
-			m_universe.setTransform(actor.entity, fromPhysx(trans));
+		jobs::ScratchScope scratch_scope;
+		Array<EntityRef> entities(jobs::getScratchAllocator());
+		Array<RigidTransform> transforms(jobs::getScratchAllocator());
+		getActiveDynamicActors(entities, transforms);
+
+		// one notification for all actors instead of one per actor
+		writeBack(entities, transforms);
+
+		updateVehicleTransforms();
+	}
+
+
+	// only `entities` are excluded from pushing the pose back to physx, their moved descendants are not
+	void writeBack(Span<const EntityRef> entities, Span<const RigidTransform> transforms)
+	{
+		for (EntityRef e : entities) m_actors[e].is_write_back = true;
+		m_universe.setTransforms(entities, transforms);
+		for (EntityRef e : entities) m_actors[e].is_write_back = false;
+	}
+
+
+	// drops interpolation of actors moved outside of physics, one pass for all of them
+	void removeTeleported()
+	{
+		if (m_teleported.empty()) return;
+
+		m_interpolated.eraseItems([this](const InterpolatedActor& a){ return m_actors[a.entity].is_teleported; });
+		for (EntityRef e : m_teleported) {
+			auto iter = m_actors.find(e);
+			if (iter.isValid()) iter.value().is_teleported = false;
 		}
-		m_update_in_progress = nullptr;
+		m_teleported.clear();
+	}
+
 
+	// called after each fixed step, actors are written to universe later by applyInterpolation
+	void storeInterpolationStep()
+	{
+		PROFILE_FUNCTION();
+		// teleported actors start from their new pose
+		removeTeleported();
+		jobs::ScratchScope scratch_scope;
+		Array<EntityRef> entities(jobs::getScratchAllocator());
+		Array<RigidTransform> transforms(jobs::getScratchAllocator());
+		getActiveDynamicActors(entities, transforms);
+
+		HashMap<EntityRef, u32> prev_map(jobs::getScratchAllocator());
+		prev_map.reserve(m_interpolated.size());
+		for (u32 i = 0, c = m_interpolated.size(); i < c; ++i) {
+			prev_map.insert(m_interpolated[i].entity, i);
+		}
+
+		Array<InterpolatedActor> interpolated(m_allocator);
+		interpolated.reserve(entities.size() + m_interpolated.size());
+		for (u32 i = 0, c = entities.size(); i < c; ++i) {
+			InterpolatedActor& a = interpolated.emplace();
+			a.entity = entities[i];
+			a.cur = transforms[i];
+			a.active = true;
+			auto iter = prev_map.find(entities[i]);
+			if (iter.isValid()) {
+				a.prev = m_interpolated[iter.value()].cur;
+				prev_map.erase(iter);
+			}
+			else {
+				// actor was not moving, so universe has its exact pose
+				a.prev = m_universe.getTransform(entities[i]).getRigidPart();
+			}
+		}
+		// stopped actors are kept until applyInterpolation writes their final pose, there can be more steps before that
+		for (const InterpolatedActor& old : m_interpolated) {
+			if (!prev_map.find(old.entity).isValid()) continue;
+			InterpolatedActor& a = interpolated.emplace();
+			a.entity = old.entity;
+			a.prev = old.cur;
+			a.cur = old.cur;
+			a.active = false;
+		}
+		m_interpolated.swap(interpolated);
+
+		updateVehicleTransforms();
+	}
+
+
+	void applyInterpolation(float alpha)
+	{
+		PROFILE_FUNCTION();
+		removeTeleported();
+		jobs::ScratchScope scratch_scope;
+		Array<EntityRef> entities(jobs::getScratchAllocator());
+		Array<RigidTransform> transforms(jobs::getScratchAllocator());
+		entities.reserve(m_interpolated.size());
+		transforms.reserve(m_interpolated.size());
+		for (const InterpolatedActor& a : m_interpolated) {
+			entities.push(a.entity);
+			RigidTransform& tr = transforms.emplace();
+			tr.pos = lerp(a.prev.pos, a.cur.pos, alpha);
+			tr.rot = nlerp(a.prev.rot, a.cur.rot, alpha);
+		}
+
+		writeBack(entities, transforms);
+		// stopped actors are at their final pose now
+		m_interpolated.eraseItems([](const InterpolatedActor& a){ return !a.active; });
+	}
+
+
+	// moves actors to their latest simulated pose, so nothing is left at an interpolated pose
+	void flushInterpolation()
+	{
+		removeTeleported();
+		if (m_interpolated.empty()) return;
+		applyInterpolation(1);
+		m_interpolated.clear();
+	}
+
+
+	void updateVehicleTransforms()
+	{
 		for (auto iter = m_vehicles.begin(), end = m_vehicles.end(); iter != end; ++iter) {
 			Vehicle* veh = iter.value().get();
 			if (veh->actor) {
@@ -1739,9 +1904,46 @@ struct PhysicsSceneImpl final : PhysicsScene
 	}
 
 
+	void onSimulationStep()
+	{
+		if (m_interpolate && m_fixed_timestep > 0) {
+			storeInterpolationStep();
+		}
+		else {
+			updateDynamicActors();
+		}
+	}
+
+
+	void finishSimulation()
+	{
+		if (!m_is_simulating) return;
+		fetchResults();
+		m_is_simulating = false;
+		onSimulationStep();
+	}
+
+
+	void endFrame(float time_delta)
+	{
+		if (m_interpolate && m_fixed_timestep > 0) {
+			applyInterpolation(m_time_accumulator / m_fixed_timestep);
+		}
+		updateControllers(time_delta);
+
+		render();
+	}
+
+
 	void updateControllers(float time_delta)
 	{
 		PROFILE_FUNCTION();
+		jobs::ScratchScope scratch_scope;
+		Array<EntityRef> entities(jobs::getScratchAllocator());
+		Array<RigidTransform> transforms(jobs::getScratchAllocator());
+		entities.reserve(m_controllers.size());
+		transforms.reserve(m_controllers.size());
+		const float scene_gravity = m_scene->getGravity().y;
 		for (auto& controller : m_controllers)
 		{
 			Vec3 dif = controller.frame_change;
@@ -1756,7 +1958,7 @@ struct PhysicsSceneImpl final : PhysicsScene
 			}
 			else
 			{
-				gravity_acceleration = m_scene->getGravity().y;
+				gravity_acceleration = scene_gravity;
 			}
 
 			bool apply_gravity = (state.collisionFlags & PxControllerCollisionFlag::eCOLLISION_DOWN) == 0;
@@ -1771,14 +1973,22 @@ struct PhysicsSceneImpl final : PhysicsScene
 			}
 
 			if (squaredLength(dif) > 0.00001f) {
-				m_filter_callback.m_filter_data = controller.filter_data;
-				PxControllerFilters filters(nullptr, &m_filter_callback);
+				// filter state is per move, nothing shared between controllers
+				FilterCallback filter;
+				filter.m_filter_data = controller.filter_data;
+				PxControllerFilters filters(nullptr, &filter);
 				controller.controller->move(toPhysx(dif), 0.001f, time_delta, filters);
 				PxExtendedVec3 p = controller.controller->getFootPosition();
 
-				m_universe.setPosition(controller.entity, {p.x, p.y, p.z});
+				entities.push(controller.entity);
+				transforms.push({DVec3(p.x, p.y, p.z), m_universe.getRotation(controller.entity)});
 			}
 		}
+
+		// controllers are already at these positions
+		m_is_updating_controllers = true;
+		m_universe.setTransforms(entities, transforms);
+		m_is_updating_controllers = false;
 	}
 
 	void updateVehicles(float time_delta) {
@@ -1811,6 +2021,12 @@ struct PhysicsSceneImpl final : PhysicsScene
 	void lateUpdate(float time_delta, bool paused) override {
 		if (!m_is_game_running || paused) return;
 
+		if (m_async_simulate) {
+			// simulation was running since update(), hidden behind other scenes' updates
+			finishSimulation();
+			endFrame(time_delta);
+		}
+
 		AnimationScene* anim_scene = (AnimationScene*)m_universe.getScene("animation");
 		if (!anim_scene) return;
 
@@ -1828,17 +2044,75 @@ struct PhysicsSceneImpl final : PhysicsScene
 	{
 		if (!m_is_game_running || paused) return;
 
-		time_delta = minimum(1 / 20.0f, time_delta);
-		updateVehicles(time_delta);
-		simulateScene(time_delta);
-		fetchResults();
-		updateDynamicActors();
-		updateControllers(time_delta);
+		u32 steps = 1;
+		float step = minimum(1 / 20.0f, time_delta);
+		if (m_fixed_timestep > 0) {
+			step = m_fixed_timestep;
+			m_time_accumulator += time_delta;
+			steps = u32(m_time_accumulator / step);
+			if (steps > m_max_substeps) {
+				// can not keep up, drop the time we are not able to simulate
+				steps = m_max_substeps;
+				m_time_accumulator = fmodf(m_time_accumulator, step);
+			}
+			else {
+				m_time_accumulator -= steps * step;
+			}
+		}
 
-		render();
+		for (u32 i = 0; i < steps; ++i) {
+			updateVehicles(step);
+			simulateScene(step);
+			m_is_simulating = true;
+			// last step in async mode is fetched in lateUpdate
+			if (!m_async_simulate || i + 1 < steps) finishSimulation();
+		}
+
+		if (!m_async_simulate) endFrame(time_delta);
+	}
+
+
+	void setFixedTimestep(float step) override
+	{
+		finishSimulation();
+		flushInterpolation();
+		m_fixed_timestep = maximum(step, 0.f);
+		m_time_accumulator = 0;
+	}
+
+
+	float getFixedTimestep() override { return m_fixed_timestep; }
+	void setMaxSubsteps(u32 count) override { m_max_substeps = maximum(count, 1u); }
+	u32 getMaxSubsteps() override { return m_max_substeps; }
+	bool getInterpolation() override { return m_interpolate; }
+	bool getAsyncSimulation() override { return m_async_simulate; }
+
+
+	void setInterpolation(bool enable) override
+	{
+		finishSimulation();
+		flushInterpolation();
+		m_interpolate = enable;
 	}
 
 
+	void setAsyncSimulation(bool enable) override
+	{
+		finishSimulation();
+		m_async_simulate = enable;
+	}
+
+
+	void setSimulationWorkers(u32 count) override
+	{
+		finishSimulation();
+		m_cpu_dispatcher.pinned_workers = minimum(count, (u32)jobs::getWorkersCount());
+	}
+
+
+	u32 getSimulationWorkers() override { return m_cpu_dispatcher.pinned_workers; }
+
+
 	DelegateList<void(const ContactData&)>& onContact() override { return m_contact_callbacks; }
 
 
@@ -2229,7 +2503,13 @@ struct PhysicsSceneImpl final : PhysicsScene
 	}
 
 
-	void stopGame() override { m_is_game_running = false; }
+	void stopGame() override
+	{
+		finishSimulation();
+		flushInterpolation();
+		m_time_accumulator = 0;
+		m_is_game_running = false;
+	}
 
 
 	float getControllerRadius(EntityRef entity) override { return m_controllers[entity].radius; }
@@ -2376,6 +2656,19 @@ struct PhysicsSceneImpl final : PhysicsScene
 	};
 
 
+	static void toRaycastHit(const PxLocationHit& hit, RaycastHit& result)
+	{
+		result.normal = fromPhysx(hit.normal);
+		result.position = fromPhysx(hit.position);
+		result.entity = INVALID_ENTITY;
+		if (hit.shape)
+		{
+			PxRigidActor* actor = hit.shape->getActor();
+			if (actor) result.entity = EntityPtr{(int)(intptr_t)actor->userData};
+		}
+	}
+
+
 	bool raycastEx(const Vec3& origin,
 		const Vec3& dir,
 		float distance,
@@ -2397,21 +2690,81 @@ struct PhysicsSceneImpl final : PhysicsScene
 		PxQueryFilterData filter_data;
 		filter_data.flags = PxQueryFlag::eDYNAMIC | PxQueryFlag::eSTATIC | PxQueryFlag::ePREFILTER;
 		bool status = m_scene->raycast(physx_origin, unit_dir, max_distance, hit, flags, filter_data, &filter);
-		result.normal.x = hit.block.normal.x;
-		result.normal.y = hit.block.normal.y;
-		result.normal.z = hit.block.normal.z;
-		result.position.x = hit.block.position.x;
-		result.position.y = hit.block.position.y;
-		result.position.z = hit.block.position.z;
-		result.entity = INVALID_ENTITY;
-		if (hit.block.shape)
-		{
-			PxRigidActor* actor = hit.block.shape->getActor();
-			if (actor) result.entity = EntityPtr{(int)(intptr_t)actor->userData};
-		}
+		toRaycastHit(hit.block, result);
 		return status;
 	}
 
+
+	void raycastBatch(Span<const RaycastQuery> queries, Span<RaycastHit> results) override
+	{
+		PROFILE_FUNCTION();
+		ASSERT(queries.length() == results.length());
+		// scene queries are read only, so they can run concurrently
+		jobs::parallelFor(queries.length(), [&](i32 from, i32 to){
+			PROFILE_BLOCK("raycasts");
+			for (i32 i = from; i < to; ++i) {
+				const RaycastQuery& q = queries[i];
+				if (!raycastEx(q.origin, q.dir, q.distance, results[i], q.ignored, q.layer)) {
+					results[i].entity = INVALID_ENTITY;
+				}
+			}
+		}, 16);
+	}
+
+
+	void sweepSphereBatch(Span<const SphereSweepQuery> queries, Span<RaycastHit> results) override
+	{
+		PROFILE_FUNCTION();
+		ASSERT(queries.length() == results.length());
+		jobs::parallelFor(queries.length(), [&](i32 from, i32 to){
+			PROFILE_BLOCK("sweeps");
+			Filter filter;
+			filter.scene = this;
+			PxQueryFilterData filter_data;
+			filter_data.flags = PxQueryFlag::eDYNAMIC | PxQueryFlag::eSTATIC | PxQueryFlag::ePREFILTER;
+			const PxHitFlags flags = PxHitFlag::ePOSITION | PxHitFlag::eNORMAL;
+			for (i32 i = from; i < to; ++i) {
+				const SphereSweepQuery& q = queries[i];
+				filter.entity = q.ignored;
+				filter.layer = q.layer;
+				PxSweepBuffer hit;
+				const PxTransform pose(toPhysx(q.origin));
+				if (m_scene->sweep(PxSphereGeometry(q.radius), pose, toPhysx(q.dir), q.distance, hit, flags, filter_data, &filter)) {
+					toRaycastHit(hit.block, results[i]);
+				}
+				else {
+					results[i].entity = INVALID_ENTITY;
+				}
+			}
+		}, 16);
+	}
+
+
+	void overlapSphereBatch(Span<const SphereOverlapQuery> queries, Span<EntityPtr> results) override
+	{
+		PROFILE_FUNCTION();
+		ASSERT(queries.length() == results.length());
+		jobs::parallelFor(queries.length(), [&](i32 from, i32 to){
+			PROFILE_BLOCK("overlaps");
+			Filter filter;
+			filter.scene = this;
+			PxQueryFilterData filter_data;
+			// first hit is enough, it's returned as blocking hit
+			filter_data.flags = PxQueryFlag::eDYNAMIC | PxQueryFlag::eSTATIC | PxQueryFlag::ePREFILTER | PxQueryFlag::eANY_HIT;
+			for (i32 i = from; i < to; ++i) {
+				const SphereOverlapQuery& q = queries[i];
+				filter.entity = q.ignored;
+				filter.layer = q.layer;
+				PxOverlapBuffer hit;
+				const PxTransform pose(toPhysx(q.position));
+				results[i] = INVALID_ENTITY;
+				if (m_scene->overlap(PxSphereGeometry(q.radius), pose, hit, filter_data, &filter) && hit.block.actor) {
+					results[i] = EntityPtr{(int)(intptr_t)hit.block.actor->userData};
+				}
+			}
+		}, 16);
+	}
+
 	void onEntityDestroyed(EntityRef entity)
 	{
 		for (int i = 0, c = m_joints.size(); i < c; ++i)
@@ -2423,12 +2776,18 @@ struct PhysicsSceneImpl final : PhysicsScene
 		}
 	}
 
+	void onEntitiesMoved(Span<const EntityRef> entities)
+	{
+		for (EntityRef e : entities) onEntityMoved(e);
+	}
+
+
 	void onEntityMoved(EntityRef entity)
 	{
 		const u64 cmp_mask = m_universe.getComponentsMask(entity);
 		if ((cmp_mask & m_physics_cmps_mask) == 0) return;
 		
-		if (m_universe.hasComponent(entity, CONTROLLER_TYPE)) {
+		if (!m_is_updating_controllers && m_universe.hasComponent(entity, CONTROLLER_TYPE)) {
 			auto iter = m_controllers.find(entity);
 			if (iter.isValid())
 			{
@@ -2443,8 +2802,14 @@ struct PhysicsSceneImpl final : PhysicsScene
 			auto iter = m_actors.find(entity);
 			if (iter.isValid()) {
 				RigidActor& actor = iter.value();
-				if (actor.physx_actor && m_update_in_progress != &actor)
+				// skip poses we have just read from physx
+				if (actor.physx_actor && !actor.is_write_back)
 				{
+					// kinematic actors are never interpolated
+					if (actor.dynamic_type == DynamicType::DYNAMIC && !actor.is_teleported && !m_interpolated.empty()) {
+						actor.is_teleported = true;
+						m_teleported.push(entity);
+					}
 					Transform trans = m_universe.getTransform(entity);
 					if (actor.dynamic_type == DynamicType::KINEMATIC)
 					{
@@ -2938,12 +3303,6 @@ struct PhysicsSceneImpl final : PhysicsScene
 		if (actor.dynamic_type == new_value) return;
 
 		actor.dynamic_type = new_value;
-		if (new_value == DynamicType::DYNAMIC) {
-			m_dynamic_actors.push(entity);
-		}
-		else {
-			m_dynamic_actors.swapAndPopItem(entity);
-		}
 		if (!actor.physx_actor) return;
 
 		PxTransform transform = toPhysx(m_universe.getTransform(actor.entity).getRigidPart());
@@ -3207,7 +3566,6 @@ struct PhysicsSceneImpl final : PhysicsScene
 			RigidActor actor(*this, entity);
 			serializer.read(actor.dynamic_type);
 			serializer.read(actor.is_trigger);
-			if (actor.dynamic_type == DynamicType::DYNAMIC) m_dynamic_actors.push(entity);
 			actor.layer = 0;
 			serializer.read(actor.layer);
 			
@@ -3750,6 +4108,13 @@ struct PhysicsSceneImpl final : PhysicsScene
 		Array<PxRigidActor*> actors;
 	};
 
+	struct InterpolatedActor {
+		EntityRef entity;
+		RigidTransform prev;
+		RigidTransform cur;
+		bool active;
+	};
+
 	struct InstancedMesh {
 		InstancedMesh(IAllocator& allocator) : actors(allocator) {}
 		u32 layer = 0;
@@ -3769,7 +4134,6 @@ struct PhysicsSceneImpl final : PhysicsScene
 	PxRigidDynamic* m_dummy_actor;
 	PxControllerManager* m_controller_manager;
 	PxMaterial* m_default_material;
-	FilterCallback m_filter_callback;
 
 	HashMap<EntityRef, RigidActor> m_actors;
 	HashMap<PhysicsGeometry*, EntityRef> m_resource_actor_map;
@@ -3786,8 +4150,16 @@ struct PhysicsSceneImpl final : PhysicsScene
 	PxRaycastQueryResult* m_vehicle_results;
 	u64 m_physics_cmps_mask;
 
-	Array<EntityRef> m_dynamic_actors;
-	RigidActor* m_update_in_progress;
+	bool m_is_updating_controllers = false;
+	// 0 means variable timestep
+	float m_fixed_timestep = 0;
+	u32 m_max_substeps = 4;
+	float m_time_accumulator = 0;
+	bool m_interpolate = false;
+	bool m_async_simulate = false;
+	bool m_is_simulating = false;
+	Array<InterpolatedActor> m_interpolated;
+	Array<EntityRef> m_teleported;
 	DelegateList<void(const ContactData&)> m_contact_callbacks;
 	bool m_is_game_running;
 	u32 m_debug_visualization_flags;
@@ -3803,9 +4175,10 @@ PhysicsSceneImpl::PhysicsSceneImpl(Engine& engine, Universe& context, PhysicsSys
 	, m_vehicles(m_allocator)
 	, m_wheels(m_allocator)
 	, m_terrains(m_allocator)
-	, m_dynamic_actors(m_allocator)
 	, m_instanced_cubes(m_allocator)
 	, m_instanced_meshes(m_allocator)
+	, m_interpolated(m_allocator)
+	, m_teleported(m_allocator)
 	, m_universe(context)
 	, m_is_game_running(false)
 	, m_contact_callback(*this)
@@ -3813,7 +4186,6 @@ PhysicsSceneImpl::PhysicsSceneImpl(Engine& engine, Universe& context, PhysicsSys
 	, m_joints(m_allocator)
 	, m_script_scene(nullptr)
 	, m_debug_visualization_flags(0)
-	, m_update_in_progress(nullptr)
 	, m_vehicle_batch_query(nullptr)
 	, m_system(&system)
 	, m_hit_report(*this)
@@ -3836,7 +4208,7 @@ PhysicsSceneImpl::PhysicsSceneImpl(Engine& engine, Universe& context, PhysicsSys
 UniquePtr<PhysicsScene> PhysicsScene::create(PhysicsSystem& system, Universe& context, Engine& engine, IAllocator& allocator)
 {
 	PhysicsSceneImpl* impl = LUMIX_NEW(allocator, PhysicsSceneImpl)(engine, context, system, allocator);
-	impl->m_universe.entityTransformed().bind<&PhysicsSceneImpl::onEntityMoved>(impl);
+	impl->m_universe.entitiesTransformed().bind<&PhysicsSceneImpl::onEntitiesMoved>(impl);
 	impl->m_universe.entityDestroyed().bind<&PhysicsSceneImpl::onEntityDestroyed>(impl);
 	PxSceneDesc sceneDesc(system.getPhysics()->getTolerancesScale());
 	sceneDesc.gravity = PxVec3(0.0f, -9.8f, 0.0f);
@@ -3844,6 +4216,7 @@ UniquePtr<PhysicsScene> PhysicsScene::create(PhysicsSystem& system, Universe& co
 
 	sceneDesc.filterShader = impl->filterShader;
 	sceneDesc.simulationEventCallback = &impl->m_contact_callback;
+	sceneDesc.flags |= PxSceneFlag::eENABLE_ACTIVE_ACTORS | PxSceneFlag::eEXCLUDE_KINEMATICS_FROM_ACTIVE_ACTORS;
 
 	impl->m_scene = system.getPhysics()->createScene(sceneDesc);
 	if (!impl->m_scene)
@@ -3911,6 +4284,11 @@ void PhysicsScene::reflect() {
 
 	LUMIX_SCENE(PhysicsSceneImpl, "physics")
 		.LUMIX_FUNC(PhysicsSceneImpl::raycast)
+		.LUMIX_FUNC(PhysicsSceneImpl::setFixedTimestep)
+		.LUMIX_FUNC(PhysicsSceneImpl::setMaxSubsteps)
+		.LUMIX_FUNC(PhysicsSceneImpl::setInterpolation)
+		.LUMIX_FUNC(PhysicsSceneImpl::setAsyncSimulation)
+		.LUMIX_FUNC(PhysicsSceneImpl::setSimulationWorkers)
 		.LUMIX_CMP(D6Joint, "d6_joint", "Physics / Joint / D6")
 			.LUMIX_PROP(JointConnectedBody, "Connected body")
 			.LUMIX_PROP(JointAxisPosition, "Axis position")
@@ -48,6 +48,37 @@ struct RaycastHit
 };
 
 
+// layer -1 collides with everything
+struct RaycastQuery
+{
+	Vec3 origin;
+	Vec3 dir;
+	float distance;
+	EntityPtr ignored = INVALID_ENTITY;
+	int layer = -1;
+};
+
+
+struct SphereSweepQuery
+{
+	Vec3 origin;
+	Vec3 dir;
+	float radius;
+	float distance;
+	EntityPtr ignored = INVALID_ENTITY;
+	int layer = -1;
+};
+
+
+struct SphereOverlapQuery
+{
+	Vec3 position;
+	float radius;
+	EntityPtr ignored = INVALID_ENTITY;
+	int layer = -1;
+};
+
+
 struct LUMIX_PHYSICS_API PhysicsScene : IScene
 {
 	enum class D6Motion : int
@@ -91,7 +122,27 @@ struct LUMIX_PHYSICS_API PhysicsScene : IScene
 	virtual void render() = 0;
 	virtual EntityPtr raycast(const Vec3& origin, const Vec3& dir, EntityPtr ignore_entity) = 0;
 	virtual bool raycastEx(const Vec3& origin, const Vec3& dir, float distance, RaycastHit& result, EntityPtr ignored, int layer) = 0;
+	// batched queries run in parallel on job workers, results[i] belongs to queries[i], entity is invalid if nothing was hit;
+	// must not be called while the scene is being modified
+	virtual void raycastBatch(Span<const RaycastQuery> queries, Span<RaycastHit> results) = 0;
+	virtual void sweepSphereBatch(Span<const SphereSweepQuery> queries, Span<RaycastHit> results) = 0;
+	// returns any one overlapping entity per query
+	virtual void overlapSphereBatch(Span<const SphereOverlapQuery> queries, Span<EntityPtr> results) = 0;
 	virtual PhysicsSystem& getSystem() const = 0;
+	// fixed timestep in seconds, 0 to simulate with variable frame time
+	virtual void setFixedTimestep(float step) = 0;
+	virtual float getFixedTimestep() = 0;
+	virtual void setMaxSubsteps(u32 count) = 0;
+	virtual u32 getMaxSubsteps() = 0;
+	// interpolate dynamic actors between the last two fixed steps
+	virtual void setInterpolation(bool enable) = 0;
+	virtual bool getInterpolation() = 0;
+	// simulate in update and fetch results in lateUpdate, overlapping other scenes' updates
+	virtual void setAsyncSimulation(bool enable) = 0;
+	virtual bool getAsyncSimulation() = 0;
+	// run PhysX tasks only on this many job workers, 0 to use all of them
+	virtual void setSimulationWorkers(u32 count) = 0;
+	virtual u32 getSimulationWorkers() = 0;
 
 	virtual DelegateList<void(const ContactData&)>& onContact() = 0;
 	virtual void setActorLayer(EntityRef entity, u32 layer) = 0;
@@ -14,6 +14,7 @@
 
 #include "cooking/PxCooking.h"
 #include "engine/engine.h"
+#include "engine/job_system.h"
 #include "engine/log.h"
 #include "engine/lua_wrapper.h"
 #include "engine/resource_manager.h"
@@ -108,6 +109,134 @@ namespace Lumix
 		return 1;
 	}
 
+	static bool toQuery(lua_State* L, int idx, RaycastQuery& q)
+	{
+		if (!lua_istable(L, idx)) return false;
+		if (!LuaWrapper::checkField(L, idx, "origin", &q.origin)) return false;
+		if (!LuaWrapper::checkField(L, idx, "dir", &q.dir)) return false;
+		q.distance = FLT_MAX;
+		LuaWrapper::getOptionalField(L, idx, "distance", &q.distance);
+		return true;
+	}
+
+	static bool toQuery(lua_State* L, int idx, SphereSweepQuery& q)
+	{
+		if (!lua_istable(L, idx)) return false;
+		if (!LuaWrapper::checkField(L, idx, "origin", &q.origin)) return false;
+		if (!LuaWrapper::checkField(L, idx, "dir", &q.dir)) return false;
+		if (!LuaWrapper::checkField(L, idx, "radius", &q.radius)) return false;
+		if (!LuaWrapper::checkField(L, idx, "distance", &q.distance)) return false;
+		return true;
+	}
+
+	static bool toQuery(lua_State* L, int idx, SphereOverlapQuery& q)
+	{
+		if (!lua_istable(L, idx)) return false;
+		if (!LuaWrapper::checkField(L, idx, "position", &q.position)) return false;
+		if (!LuaWrapper::checkField(L, idx, "radius", &q.radius)) return false;
+		return true;
+	}
+
+	// reads array of query tables from argument 2, layer is optional argument 3
+	template <typename T>
+	static bool toQueries(lua_State* L, Array<T>& queries)
+	{
+		const int layer = lua_gettop(L) > 2 ? LuaWrapper::toType<int>(L, 3) : -1;
+		const u32 count = (u32)lua_objlen(L, 2);
+		queries.resize(count);
+		for (u32 i = 0; i < count; ++i) {
+			lua_rawgeti(L, 2, i + 1);
+			const bool valid = toQuery(L, -1, queries[i]);
+			lua_pop(L, 1);
+			if (!valid) return false;
+			queries[i].layer = layer;
+		}
+		return true;
+	}
+
+	// array of false or {entity, position, normal}
+	static void pushHits(lua_State* L, Span<const RaycastHit> hits, Universe& universe)
+	{
+		lua_createtable(L, hits.length(), 0);
+		for (u32 i = 0; i < hits.length(); ++i) {
+			const RaycastHit& hit = hits[i];
+			if (hit.entity.isValid()) {
+				lua_createtable(L, 0, 3);
+				LuaWrapper::pushEntity(L, hit.entity, &universe);
+				lua_setfield(L, -2, "entity");
+				LuaWrapper::setField(L, -1, "position", hit.position);
+				LuaWrapper::setField(L, -1, "normal", hit.normal);
+			}
+			else {
+				lua_pushboolean(L, false);
+			}
+			lua_rawseti(L, -2, i + 1);
+		}
+	}
+
+	static int LUA_raycastBatch(lua_State* L)
+	{
+		auto* scene = LuaWrapper::checkArg<PhysicsScene*>(L, 1);
+		LuaWrapper::checkTableArg(L, 2);
+		bool valid;
+		{
+			Array<RaycastQuery> queries(jobs::getAllocator());
+			valid = toQueries(L, queries);
+			if (valid) {
+				Array<RaycastHit> hits(jobs::getAllocator());
+				hits.resize(queries.size());
+				scene->raycastBatch(queries, hits);
+				pushHits(L, hits, scene->getUniverse());
+			}
+		}
+		if (!valid) luaL_argerror(L, 2, "expected array of {origin, dir, [distance]}");
+		return 1;
+	}
+
+	static int LUA_sweepSphereBatch(lua_State* L)
+	{
+		auto* scene = LuaWrapper::checkArg<PhysicsScene*>(L, 1);
+		LuaWrapper::checkTableArg(L, 2);
+		bool valid;
+		{
+			Array<SphereSweepQuery> queries(jobs::getAllocator());
+			valid = toQueries(L, queries);
+			if (valid) {
+				Array<RaycastHit> hits(jobs::getAllocator());
+				hits.resize(queries.size());
+				scene->sweepSphereBatch(queries, hits);
+				pushHits(L, hits, scene->getUniverse());
+			}
+		}
+		if (!valid) luaL_argerror(L, 2, "expected array of {origin, dir, radius, distance}");
+		return 1;
+	}
+
+	// array of overlapping entities, false where there is nothing
+	static int LUA_overlapSphereBatch(lua_State* L)
+	{
+		auto* scene = LuaWrapper::checkArg<PhysicsScene*>(L, 1);
+		LuaWrapper::checkTableArg(L, 2);
+		bool valid;
+		{
+			Array<SphereOverlapQuery> queries(jobs::getAllocator());
+			valid = toQueries(L, queries);
+			if (valid) {
+				Array<EntityPtr> entities(jobs::getAllocator());
+				entities.resize(queries.size());
+				scene->overlapSphereBatch(queries, entities);
+				lua_createtable(L, entities.size(), 0);
+				for (u32 i = 0; i < entities.size(); ++i) {
+					if (entities[i].isValid()) LuaWrapper::pushEntity(L, entities[i], &scene->getUniverse());
+					else lua_pushboolean(L, false);
+					lua_rawseti(L, -2, i + 1);
+				}
+			}
+		}
+		if (!valid) luaL_argerror(L, 2, "expected array of {position, radius}");
+		return 1;
+	}
+
 	struct PhysicsSystemImpl final : PhysicsSystem
 	{
 		explicit PhysicsSystemImpl(Engine& engine)
@@ -132,6 +261,9 @@ namespace Lumix
 			m_material_manager.create(PhysicsMaterial::TYPE, engine.getResourceManager());
 			m_geometry_manager.create(PhysicsGeometry::TYPE, engine.getResourceManager());
 			LuaWrapper::createSystemFunction(engine.getState(), "Physics", "raycast", &LUA_raycast);
+			LuaWrapper::createSystemFunction(engine.getState(), "Physics", "raycastBatch", &LUA_raycastBatch);
+			LuaWrapper::createSystemFunction(engine.getState(), "Physics", "sweepSphereBatch", &LUA_sweepSphereBatch);
+			LuaWrapper::createSystemFunction(engine.getState(), "Physics", "overlapSphereBatch", &LUA_overlapSphereBatch);
 
 			m_foundation = PxCreateFoundation(PX_PHYSICS_VERSION, m_physx_allocator, m_error_callback);
 
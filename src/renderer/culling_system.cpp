@@ -21,11 +21,17 @@ struct CellIndices
 {
 	CellIndices() {}
 	CellIndices(const DVec3& pos, float cell_size, u8 type, bool is_big)
-		: pos(pos * (1 / cell_size))
+		: pos(toCellPos(pos, cell_size))
 		, is_big(is_big)
 		, type(type)
 	{}
 
+	// floor, not truncation, so cells on both sides of 0 do not share the same indices
+	static IVec3 toCellPos(const DVec3& pos, float cell_size) {
+		const double inv = 1.0 / cell_size;
+		return IVec3((i32)floor(pos.x * inv), (i32)floor(pos.y * inv), (i32)floor(pos.z * inv));
+	}
+
 	bool operator==(const CellIndices& rhs) const { return pos == rhs.pos && type == rhs.type && is_big == rhs.is_big; }
 
 	IVec3 pos;
@@ -49,27 +55,59 @@ struct alignas(4096) CellPage {
 		CellPage* next = nullptr;
 		CellPage* prev = nullptr;
 		DVec3 origin;
+		// bounds of all spheres in the page relative to origin, only grows until the page is freed
+		Vec3 min = Vec3(FLT_MAX);
+		Vec3 max = Vec3(-FLT_MAX);
 		CellIndices indices;
 		int count = 0;
 	} header;
 
-	enum { MAX_COUNT = (PageAllocator::PAGE_SIZE - sizeof(header)) / (sizeof(Sphere) + sizeof(EntityPtr)) };
+	// multiple of 8, so culling can always load whole SIMD lanes
+	enum { MAX_COUNT = (PageAllocator::PAGE_SIZE - sizeof(header)) / (sizeof(float) * 4 + sizeof(EntityPtr)) / 8 * 8 };
+
+	void setSphere(u32 idx, const Vec3& pos, float radius) {
+		xs[idx] = pos.x;
+		ys[idx] = pos.y;
+		zs[idx] = pos.z;
+		rs[idx] = radius;
+		header.min = minimum(header.min, pos - Vec3(radius));
+		header.max = maximum(header.max, pos + Vec3(radius));
+	}
+
+	Vec3 getPosition(u32 idx) const { return Vec3(xs[idx], ys[idx], zs[idx]); }
 
-	Sphere spheres[MAX_COUNT];
+	// spheres are stored as SoA, so they can be culled 4 or 8 at once
+	alignas(32) float xs[MAX_COUNT];
+	alignas(32) float ys[MAX_COUNT];
+	alignas(32) float zs[MAX_COUNT];
+	alignas(32) float rs[MAX_COUNT];
 	EntityPtr entities[MAX_COUNT];
 };
 
 static_assert(sizeof(CellPage) == PageAllocator::PAGE_SIZE);
 
 
+// indices of visible lanes for each 4bit visibility mask, packed to the front
+static const u8 COMPRESS_LUT[16][4] = {
+	{0, 0, 0, 0}, {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0},
+	{2, 0, 0, 0}, {0, 2, 0, 0}, {1, 2, 0, 0}, {0, 1, 2, 0},
+	{3, 0, 0, 0}, {0, 3, 0, 0}, {1, 3, 0, 0}, {0, 1, 3, 0},
+	{2, 3, 0, 0}, {0, 2, 3, 0}, {1, 2, 3, 0}, {0, 1, 2, 3}
+};
+
+static const u8 COMPRESS_COUNT[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+
 struct CullingSystemImpl final : CullingSystem
 {
+	static constexpr float DEFAULT_CELL_SIZE = 300.f;
+
 	CullingSystemImpl(IAllocator& allocator, PageAllocator& page_allocator) 
 		: m_allocator(allocator)
 		, m_cell_map(allocator)
 		, m_entity_to_cell(allocator)
 		, m_cells(allocator)
-		, m_cell_size(300.0f)
+		, m_cell_size(DEFAULT_CELL_SIZE)
 		, m_page_allocator(page_allocator)
 	{
 	}
@@ -79,16 +117,16 @@ struct CullingSystemImpl final : CullingSystem
 		clear();
 	}
 	
-	Sphere* addToCell(CellPage& cell, EntityPtr entity, const DVec3& pos, float radius)
+	EntityPtr* addToCell(CellPage& cell, EntityPtr entity, const DVec3& pos, float radius)
 	{
 		const Vec3 rel_pos = Vec3(pos - cell.header.origin);
 		const int count = cell.header.count;
 
 		if(count < CellPage::MAX_COUNT - 1) {
-			cell.spheres[count] = {rel_pos, radius};
+			cell.setSphere(count, rel_pos, radius);
 			cell.entities[count] = entity;
 			++cell.header.count;
-			return &cell.spheres[count];
+			return &cell.entities[count];
 		}
 
 		void* mem = m_page_allocator.allocate(true);
@@ -104,11 +142,11 @@ struct CullingSystemImpl final : CullingSystem
 		m_cells.push(new_cell);
 		if(!new_cell->header.prev) m_cell_map[new_cell->header.indices] = new_cell;
 
-		new_cell->spheres[0] = {rel_pos, radius};
+		new_cell->setSphere(0, rel_pos, radius);
 		new_cell->entities[0] = entity;
 		new_cell->header.count = 1;
 
-		return &new_cell->spheres[0];
+		return &new_cell->entities[0];
 	}
 
 
@@ -135,9 +173,7 @@ struct CullingSystemImpl final : CullingSystem
 		}
 
 		CellPage& cell = *iter.value();
-		Sphere* sphere = addToCell(cell, entity, pos, radius);
-		m_entity_to_cell[entity.index] = sphere;
-		return;
+		m_entity_to_cell[entity.index] = addToCell(cell, entity, pos, radius);
 	}
 
 
@@ -145,10 +181,10 @@ struct CullingSystemImpl final : CullingSystem
 	{
 		if (m_entity_to_cell.size() <= entity.index) return;
 		
-		const Sphere* sphere = m_entity_to_cell[entity.index];
-		if (!sphere) return;
+		const EntityPtr* slot = m_entity_to_cell[entity.index];
+		if (!slot) return;
 
-		CellPage& cell = getCell(*sphere);
+		CellPage& cell = getCell(slot);
 		if (cell.header.count == 1) {
 			if (!cell.header.prev) {
 				if (!cell.header.next) m_cell_map.erase(cell.header.indices);
@@ -161,20 +197,21 @@ struct CullingSystemImpl final : CullingSystem
 			m_page_allocator.deallocate(&cell, true);
 		}
 		else {
-			const int idx = int(sphere - cell.spheres);
-			EntityPtr last = cell.entities[cell.header.count - 1];
-			cell.entities[idx] = cell.entities[cell.header.count - 1];
-			cell.spheres[idx] = cell.spheres[cell.header.count - 1];
-			m_entity_to_cell[last.index] = &cell.spheres[idx];
+			const int idx = int(slot - cell.entities);
+			const int last_idx = cell.header.count - 1;
+			EntityPtr last = cell.entities[last_idx];
+			cell.entities[idx] = last;
+			cell.setSphere(idx, cell.getPosition(last_idx), cell.rs[last_idx]);
+			m_entity_to_cell[last.index] = &cell.entities[idx];
 			--cell.header.count;
 		}
 		m_entity_to_cell[entity.index] = nullptr;
 	}
 
 
-	CellPage& getCell(const Sphere& sphere) const
+	CellPage& getCell(const EntityPtr* slot) const
 	{
-		const intptr_t ptr = (intptr_t)&sphere;
+		const intptr_t ptr = (intptr_t)slot;
 		const intptr_t page_ptr = ptr - (ptr % PageAllocator::PAGE_SIZE);
 		return *(CellPage*)page_ptr;
 	}
@@ -182,17 +219,18 @@ struct CullingSystemImpl final : CullingSystem
 
 	void setPosition(EntityRef entity, const DVec3& pos) override
 	{
-		Sphere* sphere = m_entity_to_cell[entity.index];
-		CellPage& cell = getCell(*sphere);
+		EntityPtr* slot = m_entity_to_cell[entity.index];
+		CellPage& cell = getCell(slot);
+		const u32 idx = u32(slot - cell.entities);
 
-		const IVec3 new_indices(pos * (1 / m_cell_size));
+		const IVec3 new_indices = CellIndices::toCellPos(pos, m_cell_size);
 
 		if(new_indices == cell.header.indices.pos) {
-			sphere->position = Vec3(pos - cell.header.origin);
+			cell.setSphere(idx, Vec3(pos - cell.header.origin), cell.rs[idx]);
 			return;
 		}
 
-		const float radius = sphere->radius;
+		const float radius = cell.rs[idx];
 		const u8 type = cell.header.indices.type;
 		remove(entity);
 		add(entity, type, pos, radius);
@@ -201,20 +239,21 @@ struct CullingSystemImpl final : CullingSystem
 
 	float getRadius(EntityRef entity) override
 	{
-		return m_entity_to_cell[entity.index]->radius;
+		const EntityPtr* slot = m_entity_to_cell[entity.index];
+		const CellPage& cell = getCell(slot);
+		return cell.rs[slot - cell.entities];
 	}
 
 	void set(EntityRef entity, const DVec3& pos, float radius) override {
-		Sphere* sphere = m_entity_to_cell[entity.index];
-		CellPage& cell = getCell(*sphere);
-		const IVec3 new_indices(pos * (1 / m_cell_size));
-		
+		EntityPtr* slot = m_entity_to_cell[entity.index];
+		CellPage& cell = getCell(slot);
+		const IVec3 new_indices = CellIndices::toCellPos(pos, m_cell_size);
+
 		const bool was_big = cell.header.indices.is_big;
 		const bool is_big = radius > m_cell_size;
 
 		if (was_big == is_big && new_indices == cell.header.indices.pos) {
-			sphere->radius = radius;
-			sphere->position = Vec3(pos - cell.header.origin);
+			cell.setSphere(u32(slot - cell.entities), Vec3(pos - cell.header.origin), radius);
 			return;
 		}
 
@@ -225,18 +264,19 @@ struct CullingSystemImpl final : CullingSystem
 	
 	void setRadius(EntityRef entity, float radius) override
 	{
-		Sphere* sphere = m_entity_to_cell[entity.index];
-		CellPage& cell = getCell(*sphere);
+		EntityPtr* slot = m_entity_to_cell[entity.index];
+		CellPage& cell = getCell(slot);
+		const u32 idx = u32(slot - cell.entities);
 		
 		const bool was_big = cell.header.indices.is_big;
 		const bool is_big = radius > m_cell_size;
 
 		if (was_big == is_big) {
-			sphere->radius = radius;
+			cell.setSphere(idx, cell.getPosition(idx), radius);
 			return;
 		}
 		const u8 type = cell.header.indices.type;
-		const DVec3 pos = cell.header.origin + sphere->position;
+		const DVec3 pos = cell.header.origin + cell.getPosition(idx);
 		remove(entity);
 		add(entity, type, pos, radius);
 	}
@@ -260,52 +300,129 @@ struct CullingSystemImpl final : CullingSystem
 		m_entity_to_cell.clear();
 	}
 
+
+	float getCellSize() const override { return m_cell_size; }
+
+
+	void setCellSize(float size) override
+	{
+		ASSERT(size > 0);
+		if (size == m_cell_size) return;
+
+		struct Item {
+			EntityRef entity;
+			u8 type;
+			DVec3 pos;
+			float radius;
+		};
+		Array<Item> items(m_allocator);
+		for (const CellPage* cell : m_cells) {
+			for (i32 i = 0; i < cell->header.count; ++i) {
+				Item& item = items.emplace();
+				item.entity = (EntityRef)cell->entities[i];
+				item.type = cell->header.indices.type;
+				item.pos = cell->header.origin + cell->getPosition(i);
+				item.radius = cell->rs[i];
+			}
+		}
+
+		clear();
+		m_cell_size = size;
+		for (const Item& item : items) {
+			add(item.entity, item.type, item.pos, item.radius);
+		}
+	}
+
+	// writes entities of visible lanes (`mask`) of 4 spheres starting at `from` to the front of `out`
+	static LUMIX_FORCE_INLINE void compressStore(EntityRef* LUMIX_RESTRICT out, const EntityPtr* LUMIX_RESTRICT entities, u32 from, u32 mask) {
+		const u8* lut = COMPRESS_LUT[mask];
+		out[0].index = entities[from + lut[0]].index;
+		out[1].index = entities[from + lut[1]].index;
+		out[2].index = entities[from + lut[2]].index;
+		out[3].index = entities[from + lut[3]].index;
+	}
+
 	LUMIX_FORCE_INLINE void doCulling(const CellPage& cell
 		, const Frustum& frustum
 		, CullResult* LUMIX_RESTRICT results
 		, PagedList<CullResult>& list
 		, u8 type)
 	{
-		const Sphere* LUMIX_RESTRICT start = cell.spheres;
-		const Sphere* LUMIX_RESTRICT end = cell.spheres + cell.header.count;
-		const EntityPtr* LUMIX_RESTRICT sphere_to_entity_map = cell.entities;
-
-		const float4 px = f4Load(frustum.xs);
-		const float4 py = f4Load(frustum.ys);
-		const float4 pz = f4Load(frustum.zs);
-		const float4 pd = f4Load(frustum.ds);
-		const float4 px2 = f4Load(&frustum.xs[4]);
-		const float4 py2 = f4Load(&frustum.ys[4]);
-		const float4 pz2 = f4Load(&frustum.zs[4]);
-		const float4 pd2 = f4Load(&frustum.ds[4]);
-		int cursor = results->header.count;
-
-		int i = 0;
-
-		for (const Sphere *sphere = start; sphere < end; ++sphere, ++i) {
-			const float4 cx = f4Splat(sphere->position.x);
-			const float4 cy = f4Splat(sphere->position.y);
-			const float4 cz = f4Splat(sphere->position.z);
-			const float4 r = f4Splat(-sphere->radius);
-
-			float4 t = cx * px + cy * py + cz * pz + pd;
-			t = t - r;
-			if (f4MoveMask(t)) continue;
-
-			t = cx * px2 + cy * py2 + cz * pz2 + pd2;
-			t = t - r;
-			if (f4MoveMask(t)) continue;
-
-			if(cursor == lengthOf(results->entities)) {
-				results->header.count = cursor;
-				results = list.push();
-				results->header.type = type;
-				cursor = 0;
+		enum { PLANES_COUNT = (u32)Frustum::Planes::COUNT };
+		const u32 count = cell.header.count;
+		u32 cursor = results->header.count;
+
+		// sphere is outside if signed distance + radius is negative for any plane,
+		// so we take minimum over all planes and check its sign bit
+		#ifdef LUMIX_SIMD_FLOAT8
+			float8 px[PLANES_COUNT], py[PLANES_COUNT], pz[PLANES_COUNT], pd[PLANES_COUNT];
+			for (u32 i = 0; i < PLANES_COUNT; ++i) {
+				px[i] = f8Splat(frustum.xs[i]);
+				py[i] = f8Splat(frustum.ys[i]);
+				pz[i] = f8Splat(frustum.zs[i]);
+				pd[i] = f8Splat(frustum.ds[i]);
 			}
 
-			results->entities[cursor] = (EntityRef)sphere_to_entity_map[i];
-			++cursor;
-		}
+			for (u32 i = 0; i < count; i += 8) {
+				const float8 x = f8Load(&cell.xs[i]);
+				const float8 y = f8Load(&cell.ys[i]);
+				const float8 z = f8Load(&cell.zs[i]);
+				const float8 r = f8Load(&cell.rs[i]);
+				float8 dist = f8Add(f8Add(f8Mul(x, px[0]), f8Mul(y, py[0])), f8Add(f8Mul(z, pz[0]), f8Add(pd[0], r)));
+				for (u32 j = 1; j < PLANES_COUNT; ++j) {
+					const float8 t = f8Add(f8Add(f8Mul(x, px[j]), f8Mul(y, py[j])), f8Add(f8Mul(z, pz[j]), f8Add(pd[j], r)));
+					dist = f8Min(dist, t);
+				}
+				u32 visible = ~f8MoveMask(dist) & 0xff;
+				if (i + 8 > count) visible &= (1 << (count - i)) - 1;
+				if (!visible) continue;
+
+				if (cursor + 8 > lengthOf(results->entities)) {
+					results->header.count = cursor;
+					results = list.push();
+					results->header.type = type;
+					cursor = 0;
+				}
+
+				compressStore(results->entities + cursor, cell.entities, i, visible & 0xf);
+				cursor += COMPRESS_COUNT[visible & 0xf];
+				compressStore(results->entities + cursor, cell.entities, i + 4, visible >> 4);
+				cursor += COMPRESS_COUNT[visible >> 4];
+			}
+		#else
+			float4 px[PLANES_COUNT], py[PLANES_COUNT], pz[PLANES_COUNT], pd[PLANES_COUNT];
+			for (u32 i = 0; i < PLANES_COUNT; ++i) {
+				px[i] = f4Splat(frustum.xs[i]);
+				py[i] = f4Splat(frustum.ys[i]);
+				pz[i] = f4Splat(frustum.zs[i]);
+				pd[i] = f4Splat(frustum.ds[i]);
+			}
+
+			for (u32 i = 0; i < count; i += 4) {
+				const float4 x = f4Load(&cell.xs[i]);
+				const float4 y = f4Load(&cell.ys[i]);
+				const float4 z = f4Load(&cell.zs[i]);
+				const float4 r = f4Load(&cell.rs[i]);
+				float4 dist = f4Add(f4Add(f4Mul(x, px[0]), f4Mul(y, py[0])), f4Add(f4Mul(z, pz[0]), f4Add(pd[0], r)));
+				for (u32 j = 1; j < PLANES_COUNT; ++j) {
+					const float4 t = f4Add(f4Add(f4Mul(x, px[j]), f4Mul(y, py[j])), f4Add(f4Mul(z, pz[j]), f4Add(pd[j], r)));
+					dist = f4Min(dist, t);
+				}
+				u32 visible = ~f4MoveMask(dist) & 0xf;
+				if (i + 4 > count) visible &= (1 << (count - i)) - 1;
+				if (!visible) continue;
+
+				if (cursor + 4 > lengthOf(results->entities)) {
+					results->header.count = cursor;
+					results = list.push();
+					results->header.type = type;
+					cursor = 0;
+				}
+
+				compressStore(results->entities + cursor, cell.entities, i, visible);
+				cursor += COMPRESS_COUNT[visible];
+			}
+		#endif
 		results->header.count = cursor;
 	}
 
@@ -329,8 +446,6 @@ struct CullingSystemImpl final : CullingSystem
 
 		jobs::runOnWorkers([&](){
 			PROFILE_BLOCK("culling");
-			const Vec3 v3_cell_size(m_cell_size);
-			const Vec3 v3_2_cell_size(2 * m_cell_size);
 			CullResult* result = nullptr;
 			u32 total_count = 0;
 			for(;;) {
@@ -339,16 +454,18 @@ struct CullingSystemImpl final : CullingSystem
 
 				CellPage& cell = *m_cells[idx];
 				if (type != 0xff && cell.header.indices.type != type) continue;
+
+				total_count += cell.header.count;
+				const DVec3 aabb_min = cell.header.origin + cell.header.min;
+				const Vec3 aabb_size = cell.header.max - cell.header.min;
+				if (!frustum.intersectsAABB(aabb_min, aabb_size)) continue;
+
 				if (!result || result->header.type != cell.header.indices.type) {
 					result = list.push();
 					result->header.type = cell.header.indices.type;
 				}
 
-				total_count += cell.header.count;
-				if (cell.header.indices.is_big) {
-					doCulling(cell, frustum.getRelative(cell.header.origin), result, list, cell.header.indices.type);
-				}
-				else if (frustum.containsAABB(cell.header.origin + v3_cell_size, v3_cell_size)) {
+				if (frustum.containsAABB(aabb_min, aabb_size)) {
 					int to_cpy = cell.header.count;
 					int src_offset = 0;
 					while (to_cpy > 0) {
@@ -364,7 +481,7 @@ struct CullingSystemImpl final : CullingSystem
 						to_cpy -= step;
 					}
 				}
-				else if (frustum.intersectsAABB(cell.header.origin - v3_cell_size, v3_2_cell_size)) {
+				else {
 					doCulling(cell, frustum.getRelative(cell.header.origin), result, list, cell.header.indices.type);
 				}
 			}
@@ -385,7 +502,7 @@ struct CullingSystemImpl final : CullingSystem
 	PageAllocator& m_page_allocator;
 	HashMap<CellIndices, CellPage*, CellIndicesHasher> m_cell_map;
 	Array<CellPage*> m_cells;
-	Array<Sphere*> m_entity_to_cell;
+	Array<EntityPtr*> m_entity_to_cell;
 	float m_cell_size;
 };
 
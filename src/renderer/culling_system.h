@@ -2,6 +2,7 @@
 
 
 #include "engine/lumix.h"
+#include "engine/page_allocator.h"
 
 
 namespace Lumix
@@ -11,7 +12,6 @@ template <typename T> struct Array;
 template <typename T> struct UniquePtr;
 struct DVec3;
 struct IAllocator;
-struct PageAllocator;
 struct ShiftedFrustum;
 struct Sphere;
 struct Vec3;
@@ -42,9 +42,11 @@ struct CullResult {
 		u32 count = 0;
 		u8 type;
 	} header;
-	EntityRef entities[(16384 - sizeof(header)) / sizeof(EntityRef)];
+	EntityRef entities[(PageAllocator::PAGE_SIZE - sizeof(header)) / sizeof(EntityRef)];
 };
 
+static_assert(sizeof(CullResult) <= PageAllocator::PAGE_SIZE);
+
 struct LUMIX_RENDERER_API CullingSystem
 {
 	CullingSystem() { }
@@ -54,6 +56,10 @@ struct LUMIX_RENDERER_API CullingSystem
 
 	virtual void clear() = 0;
 
+	// changing cell size rebuilds the whole grid
+	virtual void setCellSize(float size) = 0;
+	virtual float getCellSize() const = 0;
+
 	virtual CullResult* cull(const ShiftedFrustum& frustum, u8 type) = 0;
 	virtual CullResult* cull(const ShiftedFrustum& frustum) = 0;
 
@@ -1403,53 +1403,124 @@ static float evalCurve(i64 time, const ofbx::AnimationCurve& curve) {
 	return 0.f;
 };
 
+// max error of keys removed from animation curves, in meters for positions and quaternion units for rotations
+static constexpr float ANIM_POSITION_ERROR = 0.0001f;
+static constexpr float ANIM_ROTATION_ERROR = 0.0001f;
+
+static bool isNear(const Vec3& a, const Vec3& b, float max_error) {
+	return fabsf(a.x - b.x) <= max_error && fabsf(a.y - b.y) <= max_error && fabsf(a.z - b.z) <= max_error;
+}
+
+static bool isNear(const Quat& a, const Quat& b, float max_error) {
+	// q and -q are the same rotation
+	const float sign = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w < 0 ? -1.f : 1.f;
+	return fabsf(a.x - b.x * sign) <= max_error
+		&& fabsf(a.y - b.y * sign) <= max_error
+		&& fabsf(a.z - b.z * sign) <= max_error
+		&& fabsf(a.w - b.w * sign) <= max_error;
+}
+
 // parent_scale - animated scale is not supported, but we can get rid of static scale if we ignore
 // it in writeSkeleton() and use `parent_scale` in this function
-static void compressPositions(float parent_scale, Array<FBXImporter::Key>& out)
+// removes keys which can be interpolated from the remaining keys with error <= `max_error`
+static void compressPositions(float parent_scale, Array<FBXImporter::Key>& out, float max_error)
 {
 	if (out.empty()) return;
 
-	const float ERROR = 0; 
-	Vec3 dir = out[1].pos - out[0].pos;
-	dir *= float(1 / ofbx::fbxTimeToSeconds(out[1].time - out[0].time));
 	u32 prev = 0;
 	for (u32 i = 2; i < (u32)out.size(); ++i) {
-		const Vec3 estimate = out[prev].pos + dir * (float)ofbx::fbxTimeToSeconds(out[i].time - out[prev].time);
-		const Vec3 diff = estimate - out[i].pos;
-		if (fabs(diff.x) > ERROR || fabs(diff.y) > ERROR || fabs(diff.z) > ERROR)  {
-			prev = i - 1;
-			dir = out[i].pos - out[i - 1].pos;
-			dir *= float(1 / ofbx::fbxTimeToSeconds(out[i].time - out[i - 1].time));
+		const double len = ofbx::fbxTimeToSeconds(out[i].time - out[prev].time);
+		bool removable = true;
+		for (u32 j = prev + 1; j < i && removable; ++j) {
+			const float t = float(ofbx::fbxTimeToSeconds(out[j].time - out[prev].time) / len);
+			removable = isNear(lerp(out[prev].pos, out[i].pos, t), out[j].pos, max_error);
 		}
-		else {
+		if (removable) {
 			out[i - 1].flags |= 1;
 		}
+		else {
+			prev = i - 1;
+		}
 	}
 	for (u32 i = 0; i < (u32)out.size(); ++i) {
 		out[i].pos *= parent_scale;
 	}
 }
 
-static void compressRotations(Array<FBXImporter::Key>& out)
+// removes keys which can be interpolated from the remaining keys with error <= `max_error`
+static void compressRotations(Array<FBXImporter::Key>& out, float max_error)
 {
 	if (out.empty()) return;
 
-	const float ERROR = 0; 
 	u32 prev = 0;
 	for (u32 i = 2; i < (u32)out.size(); ++i) {
-		const float t = float(ofbx::fbxTimeToSeconds(out[prev + 1].time - out[prev].time) / ofbx::fbxTimeToSeconds(out[i].time - out[prev].time));
-		const Quat estimate = nlerp(out[prev].rot, out[i].rot, t);
-		if (fabs(estimate.x - out[prev + 1].rot.x) > ERROR || fabs(estimate.y - out[prev + 1].rot.y) > ERROR ||
-			fabs(estimate.z - out[prev + 1].rot.z) > ERROR) 
-		{
-			prev = i - 1;
+		const double len = ofbx::fbxTimeToSeconds(out[i].time - out[prev].time);
+		bool removable = true;
+		for (u32 j = prev + 1; j < i && removable; ++j) {
+			const float t = float(ofbx::fbxTimeToSeconds(out[j].time - out[prev].time) / len);
+			removable = isNear(nlerp(out[prev].rot, out[i].rot, t), out[j].rot, max_error);
 		}
-		else {
+		if (removable) {
 			out[i - 1].flags |= 2;
 		}
+		else {
+			prev = i - 1;
+		}
 	}
 }
 
+// keep in sync with AnimationSampler::decodePosition
+static void writeQuantizedPositions(OutputMemoryStream& out, Span<const Vec3> positions) {
+	Vec3 min(FLT_MAX), max(-FLT_MAX);
+	for (const Vec3& p : positions) {
+		min = minimum(min, p);
+		max = maximum(max, p);
+	}
+	const Vec3 range = max - min;
+	const Vec3 scale(range.x / 0xffFF, range.y / 0xffFF, range.z / 0xffFF);
+	out.write(min);
+	out.write(scale);
+	auto quantize = [](float v, float from, float range) {
+		if (range <= 0) return u16(0);
+		return u16(clamp((v - from) / range, 0.f, 1.f) * 0xffFF + 0.5f);
+	};
+	for (const Vec3& p : positions) {
+		const u16 key[3] = { quantize(p.x, min.x, range.x), quantize(p.y, min.y, range.y), quantize(p.z, min.z, range.z) };
+		out.write(key, sizeof(key));
+	}
+}
+
+// keep in sync with AnimationSampler::decodeRotation
+static void writeQuantizedRotation(OutputMemoryStream& out, const Quat& rot) {
+	const float inv_len = 1 / sqrtf(rot.x * rot.x + rot.y * rot.y + rot.z * rot.z + rot.w * rot.w);
+	const float v[4] = { rot.x * inv_len, rot.y * inv_len, rot.z * inv_len, rot.w * inv_len };
+	u32 omitted = 0;
+	for (u32 i = 1; i < 4; ++i) {
+		if (fabsf(v[i]) > fabsf(v[omitted])) omitted = i;
+	}
+	// q and -q are the same rotation, make the omitted component positive so it can be reconstructed
+	const float sign = v[omitted] < 0 ? -1.f : 1.f;
+	float c[3];
+	for (u32 i = 0, j = 0; i < 4; ++i) {
+		if (i != omitted) c[j++] = v[i] * sign;
+	}
+	auto quantize = [](float f, u32 max_value) {
+		return u16(clamp((f + SQRT1_2) / (2 * SQRT1_2), 0.f, 1.f) * max_value + 0.5f);
+	};
+	const u16 key[3] = { quantize(c[0], 0xffFF), quantize(c[1], 0xffFF), u16(quantize(c[2], 0x3fFF) | (omitted << 14)) };
+	out.write(key, sizeof(key));
+}
+
+static bool isConstantRotationTrack(const Array<FBXImporter::Key>& keys, float max_error) {
+	const FBXImporter::Key* first = nullptr;
+	for (const FBXImporter::Key& key : keys) {
+		if (key.flags & 2) continue;
+		if (!first) first = &key;
+		else if (!isNear(first->rot, key.rot, max_error)) return false;
+	}
+	return true;
+}
+
 static float getScaleX(const ofbx::Matrix& mtx)
 {
 	Vec3 v(float(mtx.m[0]), float(mtx.m[4]), float(mtx.m[8]));
@@ -1640,10 +1711,11 @@ void FBXImporter::writeAnimations(const char* src, const ImportConfig& cfg)
 				ofbx::Object* parent = bone->getParent();
 				const float parent_scale = parent ? (float)getScaleX(parent->getGlobalTransform()) : 1;
 				// TODO skip curves which do not change anything
-				compressRotations(keys);
-				compressPositions(parent_scale, keys);
+				compressRotations(keys, ANIM_ROTATION_ERROR);
+				compressPositions(parent_scale, keys, ANIM_POSITION_ERROR / (parent_scale * cfg.mesh_scale * m_fbx_scale));
 			}
 
+			Array<Vec3> positions(m_allocator);
 			const u64 stream_translations_count_pos = out_file.size();
 			u32 translation_curves_count = 0;
 			write(translation_curves_count);
@@ -1676,20 +1748,31 @@ void FBXImporter::writeAnimations(const char* src, const ImportConfig& cfg)
 
 				if (isBindPosePositionTrack(count, keys, bind_pos)) continue;
 			
-				const BoneNameHash name_hash(bone->name);
-				write(name_hash);
-				write(Animation::CurveType::KEYFRAMED);
-				write(count);
-
+				positions.clear();
+				bool is_constant = true;
 				for (Key& key : keys) {
 					if ((key.flags & 1) == 0) {
-						write(fbx_to_anim_time(key.time));
+						positions.push(fixOrientation(key.pos * cfg.mesh_scale * m_fbx_scale));
+						is_constant = is_constant && isNear(positions[0], positions.last(), ANIM_POSITION_ERROR);
 					}
 				}
-				for (Key& key : keys) {
-					if ((key.flags & 1) == 0) {
-						write(fixOrientation(key.pos * cfg.mesh_scale * m_fbx_scale));
+
+				const BoneNameHash name_hash(bone->name);
+				write(name_hash);
+				if (is_constant) {
+					write(Animation::CurveType::CONSTANT);
+					write(u32(1));
+					writeQuantizedPositions(out_file, Span<const Vec3>(positions.begin(), 1));
+				}
+				else {
+					write(Animation::CurveType::KEYFRAMED);
+					write(count);
+					for (Key& key : keys) {
+						if ((key.flags & 1) == 0) {
+							write(fbx_to_anim_time(key.time));
+						}
 					}
+					writeQuantizedPositions(out_file, positions);
 				}
 				++translation_curves_count;
 			}
@@ -1729,13 +1812,23 @@ void FBXImporter::writeAnimations(const char* src, const ImportConfig& cfg)
 
 				const BoneNameHash name_hash(bone->name);
 				write(name_hash);
-				if (shouldSample(count, float(anim_len), fps, sizeof(Quat))) {
+				if (isConstantRotationTrack(keys, ANIM_ROTATION_ERROR)) {
+					write(Animation::CurveType::CONSTANT);
+					write(u32(1));
+					for (Key& key : keys) {
+						if ((key.flags & 2) == 0) {
+							writeQuantizedRotation(out_file, fixOrientation(key.rot));
+							break;
+						}
+					}
+				}
+				else if (shouldSample(count, float(anim_len), fps, sizeof(u16) * 3)) {
 					write(Animation::CurveType::SAMPLED);
 					count = u32(anim_len * fps + 0.5f);
 					write(count);
 					for (u32 i = 0; i < count; ++i) {
 						const float t = float(anim_len * ((float)i / (count - 1)));
-						write(fixOrientation(sample(*bone, *layer, t + from_frame / fps).rot));
+						writeQuantizedRotation(out_file, fixOrientation(sample(*bone, *layer, t + from_frame / fps).rot));
 					}
 				}
 				else {
@@ -1748,7 +1841,7 @@ void FBXImporter::writeAnimations(const char* src, const ImportConfig& cfg)
 					}
 					for (Key& key : keys) {
 						if ((key.flags & 2) == 0) {
-							write(fixOrientation(key.rot));
+							writeQuantizedRotation(out_file, fixOrientation(key.rot));
 						}
 					}
 				}
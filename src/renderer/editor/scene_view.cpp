@@ -1137,7 +1137,8 @@ void SceneView::handleDrop(const char* path, float x, float y)
 	else if (Path::hasExtension(path, "fab"))
 	{
 		ResourceManagerHub& manager = m_editor.getEngine().getResourceManager();
-		PrefabResource* prefab = manager.load<PrefabResource>(Path(path));
+		// we block on it below, so it should not wait behind queued loads
+		PrefabResource* prefab = manager.load<PrefabResource>(Path(path), FileSystem::Priority::HIGH);
 		const DVec3 pos = hit.origin + (hit.is_hit ? hit.t : 1) * hit.dir;
 		if (prefab->isEmpty()) {
 			FileSystem& fs = m_editor.getEngine().getFileSystem();
@@ -1,6 +1,7 @@
 #include "engine/lumix.h"
 
 #include "engine/array.h"
+#include "engine/atomic.h"
 #include "engine/crt.h"
 #include "engine/file_system.h"
 #include "engine/hash.h"
@@ -9,6 +10,7 @@
 #include "engine/path.h"
 #include "engine/profiler.h"
 #include "engine/resource_manager.h"
+#include "engine/stack_array.h"
 #include "engine/stream.h"
 #include "renderer/material.h"
 #include "renderer/model.h"
@@ -111,6 +113,9 @@ Model::Model(const Path& path, ResourceManager& resource_manager, Renderer& rend
 	, m_bone_map(m_allocator)
 	, m_meshes(m_allocator)
 	, m_bones(m_allocator)
+	, m_sorted_bones(m_allocator)
+	, m_sorted_bone_parents(m_allocator)
+	, m_bone_levels(m_allocator)
 	, m_first_nonroot_bone_index(0)
 	, m_renderer(renderer)
 {
@@ -371,6 +376,9 @@ bool Model::parseBones(InputMemoryStream& file)
 		return false;
 	}
 
+	static i32 skeleton_counter = 0;
+	m_skeleton_id = atomicIncrement(&skeleton_counter);
+
 	m_bones.reserve(bone_count);
 	for (int i = 0; i < bone_count; ++i) {
 		Model::Bone& b = m_bones.emplace(m_allocator);
@@ -408,6 +416,8 @@ bool Model::parseBones(InputMemoryStream& file)
 		}
 	}
 
+	sortBones();
+
 	for (int i = 0; i < m_bones.size(); ++i)
 	{
 			m_bones[i].inv_bind_transform = invert(m_bones[i].transform);
@@ -428,6 +438,32 @@ bool Model::parseBones(InputMemoryStream& file)
 	return true;
 }
 
+void Model::sortBones()
+{
+	// parents are always before their children, so depth can be computed in one pass
+	StackArray<u16, Bone::MAX_COUNT> depths(m_allocator);
+	depths.resize(m_bones.size());
+	u16 max_depth = 0;
+	for (int i = 0; i < m_bones.size(); ++i) {
+		const int parent = m_bones[i].parent_idx;
+		depths[i] = parent < 0 ? 0 : depths[parent] + 1;
+		max_depth = maximum(max_depth, depths[i]);
+	}
+
+	m_sorted_bones.clear();
+	m_sorted_bone_parents.clear();
+	m_bone_levels.clear();
+	for (u16 depth = 1; depth <= max_depth; ++depth) {
+		m_bone_levels.push(m_sorted_bones.size());
+		for (int i = 0; i < m_bones.size(); ++i) {
+			if (depths[i] != depth) continue;
+			m_sorted_bones.push(u16(i));
+			m_sorted_bone_parents.push(u16(m_bones[i].parent_idx));
+		}
+	}
+	m_bone_levels.push(m_sorted_bones.size());
+}
+
 int Model::getBoneIdx(const char* name)
 {
 	for (int i = 0, c = m_bones.size(); i < c; ++i)
@@ -621,6 +657,9 @@ void Model::unload()
 	}
 	m_meshes.clear();
 	m_bones.clear();
+	m_sorted_bones.clear();
+	m_sorted_bone_parents.clear();
+	m_bone_levels.clear();
 }
 
 
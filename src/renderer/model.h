@@ -182,7 +182,14 @@ public:
 	i32 getBoneParent(u32 idx) { return m_bones[idx].parent_idx; }
 	const Bone& getBone(u32 i) const { return m_bones[i]; }
 	int getFirstNonrootBoneIndex() const { return m_first_nonroot_bone_index; }
+	// non-root bones sorted by depth, bones in one level do not depend on each other
+	// level i is [getBoneLevels()[i], getBoneLevels()[i + 1])
+	Span<const u16> getSortedBones() const { return m_sorted_bones; }
+	Span<const u16> getSortedBoneParents() const { return m_sorted_bone_parents; }
+	Span<const u32> getBoneLevels() const { return m_bone_levels; }
 	BoneMap::ConstIterator getBoneIndex(BoneNameHash hash) const { return m_bone_map.find(hash); }
+	// unique for each loaded skeleton, so bone bindings cached by other resources can detect reloads
+	u32 getSkeletonID() const { return m_skeleton_id; }
 	void getPose(Pose& pose);
 	void getRelativePose(Pose& pose);
 	float getOriginBoundingRadius() const { return m_origin_bounding_radius; }
@@ -204,6 +211,7 @@ private:
 	void operator=(const Model&);
 
 	bool parseBones(InputMemoryStream& file);
+	void sortBones();
 	bool parseMeshes(InputMemoryStream& file, FileVersion version);
 	bool parseLODs(InputMemoryStream& file);
 	int getBoneIdx(const char* name);
@@ -221,8 +229,12 @@ private:
 	float m_origin_bounding_radius = 0;
 	float m_center_bounding_radius = 0;
 	BoneMap m_bone_map;
+	Array<u16> m_sorted_bones;
+	Array<u16> m_sorted_bone_parents;
+	Array<u32> m_bone_levels;
 	AABB m_aabb;
 	int m_first_nonroot_bone_index;
+	u32 m_skeleton_id = 0;
 };
 
 
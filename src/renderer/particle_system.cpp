@@ -446,7 +446,8 @@ bool ParticleEmitter::update(float dt, PageAllocator& allocator)
 	volatile i32 counter = 0;
 	jobs::runOnWorkers([&](){
 		PROFILE_FUNCTION();
-		Array<float4> reg_mem(m_allocator);
+		jobs::ScratchScope scratch_scope;
+		Array<float4> reg_mem(jobs::getScratchAllocator());
 		reg_mem.resize(m_resource->getRegistersCount() * 256);
 		for (;;) {
 			const i32 from = atomicAdd(&counter, 1024);
@@ -654,7 +655,8 @@ void ParticleEmitter::fillInstanceData(float* data) const {
 	volatile i32 counter = 0;
 	jobs::runOnWorkers([&](){
 		PROFILE_FUNCTION();
-		Array<float4> reg_mem(m_allocator);
+		jobs::ScratchScope scratch_scope;
+		Array<float4> reg_mem(jobs::getScratchAllocator());
 		reg_mem.resize(m_resource->getRegistersCount() * 256);
 		for (;;) {
 			const u32 from = (u32)atomicAdd(&counter, 1024);
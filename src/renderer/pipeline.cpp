@@ -4792,56 +4792,33 @@ struct PipelineImpl final : Pipeline
 		view.sorter.pack();
 	}
 
-	struct Histogram {
+	struct RadixSort {
 		static constexpr u32 BITS = 11;
 		static constexpr u32 SIZE = 1 << BITS;
 		static constexpr u32 BIT_MASK = SIZE - 1;
-		static constexpr i32 STEP = 4096;
-
-		u32 m_histogram[SIZE];
-		bool m_sorted;
-		jobs::Mutex m_cs;
-
-		void compute(const u64* keys, const u64* values, int size, u16 shift) {
-			memset(m_histogram, 0, sizeof(m_histogram));
-			m_sorted = true;
-
-			volatile i32 counter = 0;
-			auto work = [&](){
-				PROFILE_BLOCK("compute histogram");
-				u32 histogram[SIZE];
-				bool sorted = true;
-				memset(histogram, 0, sizeof(histogram));
-
-				i32 begin = atomicAdd(&counter, STEP);
-
-				while (begin < size) {
-					const i32 end = minimum(size, begin + STEP);
-
-					u64 key = begin > 0 ? keys[begin - 1] : keys[0];
-					u64 prev_key = key;
-					for (i32 i = begin; i < end; ++i) {
-						key = keys[i];
-						const u16 index = (key >> shift) & BIT_MASK;
-						++histogram[index];
-						sorted &= prev_key <= key;
-						prev_key = key;
-					}
-					begin = atomicAdd(&counter, STEP);
-				}
+		static constexpr i32 MIN_BLOCK_SIZE = 4096;
+		static constexpr i32 MAX_BLOCKS = 64;
+		// below this, clearing and scanning histograms costs more than the sort itself
+		static constexpr i32 SMALL_SIZE = 256;
+
+		// each block is histogrammed and scattered by one job
+		struct Block {
+			u32 histogram[SIZE];
+			bool sorted;
+		};
 
-				jobs::MutexGuard lock(m_cs);
-				m_sorted &= sorted;
-				for (u32 i = 0; i < lengthOf(m_histogram); ++i) {
-					m_histogram[i] += histogram[i]; 
+		static void insertionSort(u64* keys, u64* values, int size) {
+			for (int i = 1; i < size; ++i) {
+				const u64 key = keys[i];
+				const u64 value = values[i];
+				int j = i;
+				while (j > 0 && keys[j - 1] > key) {
+					keys[j] = keys[j - 1];
+					values[j] = values[j - 1];
+					--j;
 				}
-			};
-
-			if (size < STEP) {
-				work();
-			}
-			else {
-				jobs::runOnWorkers(work);
+				keys[j] = key;
+				values[j] = value;
 			}
 		}
 	};
@@ -4852,53 +4829,103 @@ struct PipelineImpl final : Pipeline
 		profiler::pushInt("count", size);
 		if (size == 0) return;
 
-		Array<u64> tmp_mem(m_allocator);
+		if (size <= RadixSort::SMALL_SIZE) {
+			RadixSort::insertionSort(_keys, _values, size);
+			return;
+		}
+
+		const i32 block_size = maximum(RadixSort::MIN_BLOCK_SIZE, (size + RadixSort::MAX_BLOCKS - 1) / RadixSort::MAX_BLOCKS);
+		const i32 blocks_count = (size + block_size - 1) / block_size;
+
+		jobs::ScratchScope scratch_scope;
+		IAllocator& allocator = jobs::getScratchAllocator();
+		RadixSort::Block* blocks = (RadixSort::Block*)allocator.allocate_aligned(sizeof(RadixSort::Block) * blocks_count, alignof(RadixSort::Block));
 
 		u64* keys = _keys;
 		u64* values = _values;
 		u64* tmp_keys = nullptr;
 		u64* tmp_values = nullptr;
+		u64* tmp_mem = nullptr;
 
-		Histogram histogram;
 		u16 shift = 0;
 
 		for (int pass = 0; pass < 6; ++pass) {
-			histogram.compute(keys, values, size, shift);
-
-			if (histogram.m_sorted) {
-				if (pass & 1) {
-					memcpy(_keys, tmp_mem.begin(), tmp_mem.byte_size() / 2);
-					memcpy(_values, &tmp_mem[size], tmp_mem.byte_size() / 2);
+			jobs::parallelFor(blocks_count, [&](i32 from, i32 to){
+				PROFILE_BLOCK("compute histogram");
+				for (i32 b = from; b < to; ++b) {
+					RadixSort::Block& block = blocks[b];
+					memset(block.histogram, 0, sizeof(block.histogram));
+					const i32 begin = b * block_size;
+					const i32 end = minimum(begin + block_size, size);
+					u64 prev_key = begin > 0 ? keys[begin - 1] : keys[0];
+					bool sorted = true;
+					for (i32 i = begin; i < end; ++i) {
+						const u64 key = keys[i];
+						const u16 index = (key >> shift) & RadixSort::BIT_MASK;
+						++block.histogram[index];
+						sorted &= prev_key <= key;
+						prev_key = key;
+					}
+					block.sorted = sorted;
 				}
-				return;
-			}
+			});
+
+			bool sorted = true;
+			for (i32 b = 0; b < blocks_count; ++b) sorted &= blocks[b].sorted;
+			if (sorted) break;
 
-			if (!tmp_keys) {
-				tmp_mem.resize(size * 2);
-				tmp_keys = tmp_mem.begin();
-				tmp_values = &tmp_mem[size];
+			if (!tmp_mem) {
+				tmp_mem = (u64*)allocator.allocate_aligned(size * sizeof(u64) * 2, alignof(u64));
+				tmp_keys = tmp_mem;
+				tmp_values = tmp_keys + size;
 			}
 
+			// blocks of the same digit are laid out in order, so the sort stays stable
 			u32 offset = 0;
-			for (int i = 0; i < Histogram::SIZE; ++i) {
-				const u32 count = histogram.m_histogram[i];
-				histogram.m_histogram[i] = offset;
-				offset += count;
+			bool single_digit = false;
+			for (u32 i = 0; i < RadixSort::SIZE; ++i) {
+				const u32 digit_start = offset;
+				for (i32 b = 0; b < blocks_count; ++b) {
+					const u32 count = blocks[b].histogram[i];
+					blocks[b].histogram[i] = offset;
+					offset += count;
+				}
+				single_digit |= offset - digit_start == (u32)size;
 			}
-
-			for (int i = 0; i < size; ++i) {
-				const u64 key = keys[i];
-				const u16 index = (key >> shift) & Histogram::BIT_MASK;
-				const u32 dest = histogram.m_histogram[index]++;
-				tmp_keys[dest] = key;
-				tmp_values[dest] = values[i];
+			// all keys have the same digit, scatter would not move anything
+			if (single_digit) {
+				shift += RadixSort::BITS;
+				continue;
 			}
 
+			jobs::parallelFor(blocks_count, [&](i32 from, i32 to){
+				PROFILE_BLOCK("scatter");
+				for (i32 b = from; b < to; ++b) {
+					u32* LUMIX_RESTRICT histogram = blocks[b].histogram;
+					const i32 begin = b * block_size;
+					const i32 end = minimum(begin + block_size, size);
+					for (i32 i = begin; i < end; ++i) {
+						const u64 key = keys[i];
+						const u16 index = (key >> shift) & RadixSort::BIT_MASK;
+						const u32 dest = histogram[index]++;
+						tmp_keys[dest] = key;
+						tmp_values[dest] = values[i];
+					}
+				}
+			});
+
 			swap(tmp_keys, keys);
 			swap(tmp_values, values);
 
-			shift += Histogram::BITS;
+			shift += RadixSort::BITS;
+		}
+
+		if (keys != _keys) {
+			memcpy(_keys, keys, size * sizeof(keys[0]));
+			memcpy(_values, values, size * sizeof(values[0]));
 		}
+		allocator.deallocate_aligned(tmp_mem);
+		allocator.deallocate_aligned(blocks);
 	}
 
 	void clear(u32 flags, float r, float g, float b, float a, float depth) {
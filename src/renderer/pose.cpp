@@ -1,7 +1,7 @@
 #include "renderer/pose.h"
 #include "engine/math.h"
 #include "engine/profiler.h"
-#include "engine/math.h"
+#include "engine/simd.h"
 #include "renderer/model.h"
 
 
@@ -26,13 +26,127 @@ Pose::~Pose()
 }
 
 
+// 4 bones at once, one component per float4
+struct Vec3x4 { float4 x, y, z; };
+struct Quatx4 { float4 x, y, z, w; };
+
+static const u16 CONTIGUOUS[4] = { 0, 1, 2, 3 };
+
+static LUMIX_FORCE_INLINE Vec3x4 gather(const Vec3* v, const u16* indices) {
+	alignas(16) float tmp[3][4];
+	for (u32 i = 0; i < 4; ++i) {
+		const Vec3& a = v[indices[i]];
+		tmp[0][i] = a.x;
+		tmp[1][i] = a.y;
+		tmp[2][i] = a.z;
+	}
+	return { f4Load(tmp[0]), f4Load(tmp[1]), f4Load(tmp[2]) };
+}
+
+static LUMIX_FORCE_INLINE Quatx4 gather(const Quat* q, const u16* indices) {
+	alignas(16) float tmp[4][4];
+	for (u32 i = 0; i < 4; ++i) {
+		const Quat& a = q[indices[i]];
+		tmp[0][i] = a.x;
+		tmp[1][i] = a.y;
+		tmp[2][i] = a.z;
+		tmp[3][i] = a.w;
+	}
+	return { f4Load(tmp[0]), f4Load(tmp[1]), f4Load(tmp[2]), f4Load(tmp[3]) };
+}
+
+static LUMIX_FORCE_INLINE void scatter(Vec3* v, const u16* indices, const Vec3x4& value) {
+	alignas(16) float tmp[3][4];
+	f4Store(tmp[0], value.x);
+	f4Store(tmp[1], value.y);
+	f4Store(tmp[2], value.z);
+	for (u32 i = 0; i < 4; ++i) {
+		v[indices[i]] = Vec3(tmp[0][i], tmp[1][i], tmp[2][i]);
+	}
+}
+
+static LUMIX_FORCE_INLINE void scatter(Quat* q, const u16* indices, const Quatx4& value) {
+	alignas(16) float tmp[4][4];
+	f4Store(tmp[0], value.x);
+	f4Store(tmp[1], value.y);
+	f4Store(tmp[2], value.z);
+	f4Store(tmp[3], value.w);
+	for (u32 i = 0; i < 4; ++i) {
+		q[indices[i]] = Quat(tmp[0][i], tmp[1][i], tmp[2][i], tmp[3][i]);
+	}
+}
+
+static LUMIX_FORCE_INLINE Vec3x4 lerp4(const Vec3x4& a, const Vec3x4& b, float4 t) {
+	const float4 inv = f4Sub(f4Splat(1), t);
+	return {
+		f4Add(f4Mul(a.x, inv), f4Mul(b.x, t)),
+		f4Add(f4Mul(a.y, inv), f4Mul(b.y, t)),
+		f4Add(f4Mul(a.z, inv), f4Mul(b.z, t))
+	};
+}
+
+// same as scalar nlerp
+static LUMIX_FORCE_INLINE Quatx4 nlerp4(const Quatx4& a, const Quatx4& b, float4 t) {
+	const float4 zero = f4Splat(0);
+	const float4 inv = f4Sub(f4Splat(1), t);
+	const float4 dot = f4Add(f4Add(f4Mul(a.x, b.x), f4Mul(a.y, b.y)), f4Add(f4Mul(a.z, b.z), f4Mul(a.w, b.w)));
+	const float4 tb = f4Blend(t, f4Sub(zero, t), f4CmpLT(dot, zero));
+	const Quatx4 res = {
+		f4Add(f4Mul(a.x, inv), f4Mul(b.x, tb)),
+		f4Add(f4Mul(a.y, inv), f4Mul(b.y, tb)),
+		f4Add(f4Mul(a.z, inv), f4Mul(b.z, tb)),
+		f4Add(f4Mul(a.w, inv), f4Mul(b.w, tb))
+	};
+	const float4 len_sq = f4Add(f4Add(f4Mul(res.x, res.x), f4Mul(res.y, res.y)), f4Add(f4Mul(res.z, res.z), f4Mul(res.w, res.w)));
+	const float4 inv_len = f4Div(f4Splat(1), f4Sqrt(len_sq));
+	return { f4Mul(res.x, inv_len), f4Mul(res.y, inv_len), f4Mul(res.z, inv_len), f4Mul(res.w, inv_len) };
+}
+
+// same as Quat::operator*
+static LUMIX_FORCE_INLINE Quatx4 mul4(const Quatx4& a, const Quatx4& b) {
+	return {
+		f4Sub(f4Add(f4Add(f4Mul(a.w, b.x), f4Mul(b.w, a.x)), f4Mul(a.y, b.z)), f4Mul(b.y, a.z)),
+		f4Sub(f4Add(f4Add(f4Mul(a.w, b.y), f4Mul(b.w, a.y)), f4Mul(a.z, b.x)), f4Mul(b.z, a.x)),
+		f4Sub(f4Add(f4Add(f4Mul(a.w, b.z), f4Mul(b.w, a.z)), f4Mul(a.x, b.y)), f4Mul(b.x, a.y)),
+		f4Sub(f4Sub(f4Sub(f4Mul(a.w, b.w), f4Mul(a.x, b.x)), f4Mul(a.y, b.y)), f4Mul(a.z, b.z))
+	};
+}
+
+static LUMIX_FORCE_INLINE Vec3x4 cross4(float4 ax, float4 ay, float4 az, const Vec3x4& b) {
+	return {
+		f4Sub(f4Mul(ay, b.z), f4Mul(az, b.y)),
+		f4Sub(f4Mul(az, b.x), f4Mul(ax, b.z)),
+		f4Sub(f4Mul(ax, b.y), f4Mul(ay, b.x))
+	};
+}
+
+// same as Quat::rotate
+static LUMIX_FORCE_INLINE Vec3x4 rotate4(const Quatx4& q, const Vec3x4& v) {
+	const Vec3x4 uv = cross4(q.x, q.y, q.z, v);
+	const Vec3x4 uuv = cross4(q.x, q.y, q.z, uv);
+	const float4 two = f4Splat(2);
+	const float4 w2 = f4Mul(q.w, two);
+	return {
+		f4Add(f4Add(v.x, f4Mul(uv.x, w2)), f4Mul(uuv.x, two)),
+		f4Add(f4Add(v.y, f4Mul(uv.y, w2)), f4Mul(uuv.y, two)),
+		f4Add(f4Add(v.z, f4Mul(uv.z, w2)), f4Mul(uuv.z, two))
+	};
+}
+
+
 void Pose::blend(Pose& rhs, float weight)
 {
 	ASSERT(count == rhs.count);
 	if (weight <= 0.001f) return;
 	weight = clamp(weight, 0.0f, 1.0f);
+	const float4 t = f4Splat(weight);
+	u32 i = 0;
+	for (; i + 4 <= count; i += 4) {
+		scatter(positions + i, CONTIGUOUS, lerp4(gather(positions + i, CONTIGUOUS), gather(rhs.positions + i, CONTIGUOUS), t));
+		scatter(rotations + i, CONTIGUOUS, nlerp4(gather(rotations + i, CONTIGUOUS), gather(rhs.rotations + i, CONTIGUOUS), t));
+	}
 	float inv = 1.0f - weight;
-	for (int i = 0, c = count; i < c; ++i)
+	for (; i < count; ++i)
 	{
 		positions[i] = positions[i] * inv + rhs.positions[i] * weight;
 		rotations[i] = nlerp(rotations[i], rhs.rotations[i], weight);
@@ -40,6 +154,37 @@ void Pose::blend(Pose& rhs, float weight)
 }
 
 
+void Pose::blendPositions(Span<const u16> bones, const Vec3* values, float weight)
+{
+	const float4 t = f4Splat(weight);
+	const u32 n = bones.length();
+	u32 i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const u16* indices = bones.begin() + i;
+		scatter(positions, indices, lerp4(gather(positions, indices), gather(values + i, CONTIGUOUS), t));
+	}
+	const float inv = 1.0f - weight;
+	for (; i < n; ++i) {
+		positions[bones[i]] = positions[bones[i]] * inv + values[i] * weight;
+	}
+}
+
+
+void Pose::blendRotations(Span<const u16> bones, const Quat* values, float weight)
+{
+	const float4 t = f4Splat(weight);
+	const u32 n = bones.length();
+	u32 i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const u16* indices = bones.begin() + i;
+		scatter(rotations, indices, nlerp4(gather(rotations, indices), gather(values + i, CONTIGUOUS), t));
+	}
+	for (; i < n; ++i) {
+		rotations[bones[i]] = nlerp(rotations[bones[i]], values[i], weight);
+	}
+}
+
+
 void Pose::resize(int count)
 {
 	is_absolute = false;
@@ -62,11 +207,30 @@ void Pose::resize(int count)
 void Pose::computeAbsolute(Model& model)
 {
 	if (is_absolute) return;
-	for (u32 i = model.getFirstNonrootBoneIndex(); i < count; ++i)
-	{
-		int parent = model.getBone(i).parent_idx;
-		positions[i] = rotations[parent].rotate(positions[i]) + positions[parent];
-		rotations[i] = rotations[parent] * rotations[i];
+	ASSERT(count == (u32)model.getBoneCount());
+
+	// bones in a level depend only on bones in previous levels, so each level can be processed 4 bones at once
+	const Span<const u16> bones = model.getSortedBones();
+	const Span<const u16> parents = model.getSortedBoneParents();
+	const Span<const u32> levels = model.getBoneLevels();
+	for (u32 level = 0; level + 1 < levels.length(); ++level) {
+		u32 i = levels[level];
+		const u32 end = levels[level + 1];
+		for (; i + 4 <= end; i += 4) {
+			const u16* indices = bones.begin() + i;
+			const u16* parent_indices = parents.begin() + i;
+			const Quatx4 parent_rot = gather(rotations, parent_indices);
+			const Vec3x4 parent_pos = gather(positions, parent_indices);
+			const Vec3x4 pos = rotate4(parent_rot, gather(positions, indices));
+			scatter(positions, indices, { f4Add(pos.x, parent_pos.x), f4Add(pos.y, parent_pos.y), f4Add(pos.z, parent_pos.z) });
+			scatter(rotations, indices, mul4(parent_rot, gather(rotations, indices)));
+		}
+		for (; i < end; ++i) {
+			const u32 bone = bones[i];
+			const u32 parent = parents[i];
+			positions[bone] = rotations[parent].rotate(positions[bone]) + positions[parent];
+			rotations[bone] = rotations[parent] * rotations[bone];
+		}
 	}
 	is_absolute = true;
 }
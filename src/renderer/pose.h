@@ -24,6 +24,10 @@ struct LUMIX_RENDERER_API Pose
 	void computeAbsolute(Model& model);
 	void computeRelative(Model& model);
 	void blend(Pose& rhs, float weight);
+	// positions[bones[i]] = lerp(positions[bones[i]], values[i], weight), `bones` must be unique
+	void blendPositions(Span<const u16> bones, const Vec3* values, float weight);
+	// rotations[bones[i]] = nlerp(rotations[bones[i]], values[i], weight), `bones` must be unique
+	void blendRotations(Span<const u16> bones, const Quat* values, float weight);
 
 	IAllocator& allocator;
 	bool is_absolute;
@@ -7,6 +7,7 @@
 #include "engine/file_system.h"
 #include "engine/geometry.h"
 #include "engine/hash.h"
+#include "engine/job_system.h"
 #include "engine/log.h"
 #include "engine/lua_wrapper.h"
 #include "engine/math.h"
@@ -99,7 +100,7 @@ struct RenderSceneImpl final : RenderScene {
 	~RenderSceneImpl()
 	{
 		m_renderer.destroy(m_reflection_probes_texture);
-		m_universe.entityTransformed().unbind<&RenderSceneImpl::onEntityMoved>(this);
+		m_universe.entitiesTransformed().unbind<&RenderSceneImpl::onEntitiesMoved>(this);
 		m_universe.entityDestroyed().unbind<&RenderSceneImpl::onEntityDestroyed>(this);
 		m_culling_system.reset();
 	}
@@ -831,7 +832,7 @@ struct RenderSceneImpl final : RenderScene {
 		
 		probe.load_job = LUMIX_NEW(m_allocator, ReflectionProbe::LoadJob)(*this, entity, m_allocator);
 		FileSystem::ContentCallback cb = makeDelegate<&ReflectionProbe::LoadJob::callback>(probe.load_job);
-		probe.load_job->m_handle = m_engine.getFileSystem().getContent(Path(path_str), cb);
+		probe.load_job->m_handle = m_engine.getFileSystem().getContent(Path(path_str), cb, FileSystem::Priority::NORMAL);
 	}
 
 	void deserializeEnvironmentProbes(InputMemoryStream& serializer, const EntityMap& entity_map)
@@ -928,6 +929,7 @@ struct RenderSceneImpl final : RenderScene {
 
 	void serialize(OutputMemoryStream& serializer) override
 	{
+		serializer.write(m_culling_system->getCellSize());
 		serializeCameras(serializer);
 		serializeModelInstances(serializer);
 		serializeLights(serializer);
@@ -1162,6 +1164,10 @@ struct RenderSceneImpl final : RenderScene {
 
 	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override
 	{
+		if (version > (i32)RenderSceneVersion::CULLING_CELL_SIZE) {
+			// read first, so the culling grid is built only once
+			m_culling_system->setCellSize(serializer.read<float>());
+		}
 		deserializeCameras(serializer, entity_map);
 		if (version > (i32)RenderSceneVersion::SMALLER_MODEL_INSTANCES) {
 			deserializeModelInstances(serializer, entity_map);
@@ -1237,10 +1243,21 @@ struct RenderSceneImpl final : RenderScene {
 		}
 
 		// grid aabb
-		im.grid.aabb = AABB(Vec3(FLT_MAX), Vec3(-FLT_MAX));
-		for (const InstancedModel::InstanceData& id : im.instances) {
-			im.grid.aabb.addPoint(id.pos);
-		}
+		struct Bounds {
+			Vec3 min = Vec3(FLT_MAX);
+			Vec3 max = Vec3(-FLT_MAX);
+		};
+		Bounds bounds;
+		jobs::parallelReduce(im.instances.size(), bounds, [&](i32 from, i32 to, Bounds& partial){
+			for (i32 i = from; i < to; ++i) {
+				partial.min = minimum(partial.min, im.instances[i].pos);
+				partial.max = maximum(partial.max, im.instances[i].pos);
+			}
+		}, [](Bounds& result, const Bounds& partial){
+			result.min = minimum(result.min, partial.min);
+			result.max = maximum(result.max, partial.max);
+		}, 4096);
+		im.grid.aabb = AABB(bounds.min, bounds.max);
 
 		// cells aabb
 		const Vec2 cell_size = (im.grid.aabb.max.xz() - im.grid.aabb.min.xz()) * 0.25f;
@@ -1260,14 +1277,23 @@ struct RenderSceneImpl final : RenderScene {
 		}
 
 		// count
-		for (const InstancedModel::InstanceData& id : im.instances) {
-			for (u32 i = 0; i < 16; ++i) {
-				if (im.grid.cells[i].aabb.contains(id.pos)) {
-					++im.grid.cells[i].instance_count;
-					break;
+		struct CellCounts {
+			u32 counts[16];
+		};
+		CellCounts cell_counts = {};
+		jobs::parallelReduce(im.instances.size(), cell_counts, [&](i32 from, i32 to, CellCounts& partial){
+			for (i32 j = from; j < to; ++j) {
+				for (u32 i = 0; i < 16; ++i) {
+					if (im.grid.cells[i].aabb.contains(im.instances[j].pos)) {
+						++partial.counts[i];
+						break;
+					}
 				}
 			}
-		}
+		}, [](CellCounts& result, const CellCounts& partial){
+			for (u32 i = 0; i < 16; ++i) result.counts[i] += partial.counts[i];
+		}, 4096);
+		for (u32 i = 0; i < 16; ++i) im.grid.cells[i].instance_count = cell_counts.counts[i];
 
 		// offsets
 		for (u32 i = 1; i < 16; ++i) {
@@ -1489,6 +1515,12 @@ struct RenderSceneImpl final : RenderScene {
 	}
 
 
+	void onEntitiesMoved(Span<const EntityRef> entities)
+	{
+		for (EntityRef e : entities) onEntityMoved(e);
+	}
+
+
 	void onEntityMoved(EntityRef entity)
 	{
 		const u64 cmp_mask = m_universe.getComponentsMask(entity);
@@ -2804,6 +2836,18 @@ struct RenderSceneImpl final : RenderScene {
 		return m_active_global_light_entity;
 	}
 
+
+	void setCullingCellSize(float size) override
+	{
+		m_culling_system->setCellSize(size);
+	}
+
+
+	float getCullingCellSize() override
+	{
+		return m_culling_system->getCellSize();
+	}
+
 	ReflectionProbe& getReflectionProbe(EntityRef entity) override {
 		return m_reflection_probes[entity];
 	}
@@ -3540,7 +3584,7 @@ RenderSceneImpl::RenderSceneImpl(Renderer& renderer,
 	, m_furs(m_allocator)
 {
 
-	m_universe.entityTransformed().bind<&RenderSceneImpl::onEntityMoved>(this);
+	m_universe.entitiesTransformed().bind<&RenderSceneImpl::onEntitiesMoved>(this);
 	m_universe.entityDestroyed().bind<&RenderSceneImpl::onEntityDestroyed>(this);
 	m_culling_system = CullingSystem::create(m_allocator, engine.getPageAllocator());
 	m_model_instances.reserve(5000);
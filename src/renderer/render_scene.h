@@ -288,6 +288,7 @@ enum class RenderSceneVersion : i32 {
 	PROCEDURAL_GEOMETRY_PRIMITIVE_TYPE,
 	PROCEDURAL_GEOMETRY_INDEX_BUFFER,
 	TESSELATED_TERRAIN,
+	CULLING_CELL_SIZE,
 
 	LATEST
 };
@@ -323,6 +324,8 @@ struct LUMIX_RENDERER_API RenderScene : IScene
 	virtual void unlockPose(EntityRef entity, bool changed) = 0;
 	virtual EntityPtr getActiveEnvironment() = 0;
 	virtual void setActiveEnvironment(EntityRef entity) = 0;
+	virtual void setCullingCellSize(float size) = 0;
+	virtual float getCullingCellSize() = 0;
 	virtual Vec4 getShadowmapCascades(EntityRef entity) = 0;
 	virtual void setShadowmapCascades(EntityRef entity, const Vec4& value) = 0;
 